@@ -0,0 +1,155 @@
+#!/bin/sh
+# Generates synthetic stress programs into bench/, drives them through
+# `tdbg -batch` and prints per target latency, memory and LLDB call counts.
+#
+# Every program calls checkpoint() once its data is set up. The scripts
+# break there, step out into the interesting frame and step a few lines,
+# so each stop reports the heavy locals.
+
+set -e
+
+CC=${CC:-cc}
+TDBG=${TDBG:-./tdbg}
+DIR=bench
+
+mkdir -p $DIR
+
+checkpoint_c='__attribute__((noinline)) void checkpoint(void) { __asm__ volatile(""); }'
+
+# 1,200 locals in a single frame
+{
+	echo "$checkpoint_c"
+	echo "int many_locals(void) {"
+	i=0; while [ $i -lt 1200 ]; do echo "	int v$i = $i;"; i=$((i + 1)); done
+	echo "	checkpoint();"
+	echo "	int sum = 0;"
+	i=0; while [ $i -lt 1200 ]; do echo "	sum += v$i;"; i=$((i + 1)); done
+	echo "	return sum;"
+	echo "}"
+	echo "int main(void) { return many_locals() > 0 ? 0 : 1; }"
+} > $DIR/locals.c
+
+# Structs nested 10 levels deep, each level with a few siblings
+{
+	echo "$checkpoint_c"
+	echo "struct n0 { int a; double b; char name[16]; };"
+	i=1; while [ $i -le 10 ]; do
+		echo "struct n$i { int a; struct n$((i - 1)) left; struct n$((i - 1)) right; };"
+		i=$((i + 1))
+	done
+	echo "int main(void) {"
+	echo "	static struct n10 root;"
+	echo "	root.a = 10;"
+	echo "	struct n10 local = root;"
+	echo "	checkpoint();"
+	echo "	local.a++;"
+	echo "	return local.a == 11 ? 0 : 1;"
+	echo "}"
+} > $DIR/nested.c
+
+# A 1M element array
+cat > $DIR/array.c <<EOF
+$checkpoint_c
+int main(void) {
+	static int big[1000000];
+	int *ptr = big;
+	for (int i = 0; i < 1000000; ++i) big[i] = i;
+	checkpoint();
+	ptr[0] = 1;
+	return ptr[0] == 1 ? 0 : 1;
+}
+EOF
+
+# 10,000 frames deep
+cat > $DIR/recursion.c <<EOF
+$checkpoint_c
+int recurse(int depth, int acc) {
+	int local = depth * 2;
+	if (depth == 0) {
+		checkpoint();
+		return acc;
+	}
+	return recurse(depth - 1, acc + local);
+}
+int main(void) { return recurse(10000, 0) > 0 ? 0 : 1; }
+EOF
+
+# 128 threads parked while main stops
+cat > $DIR/threads.c <<EOF
+#include <pthread.h>
+#include <unistd.h>
+$checkpoint_c
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int started = 0;
+static int done = 0;
+void *worker(void *arg) {
+	pthread_mutex_lock(&lock);
+	started++;
+	pthread_cond_broadcast(&cond);
+	while (!done) pthread_cond_wait(&cond, &lock);
+	pthread_mutex_unlock(&lock);
+	return arg;
+}
+int main(void) {
+	pthread_t threads[128];
+	for (int i = 0; i < 128; ++i) pthread_create(&threads[i], 0, worker, 0);
+	pthread_mutex_lock(&lock);
+	while (started < 128) pthread_cond_wait(&cond, &lock);
+	pthread_mutex_unlock(&lock);
+	checkpoint();
+	pthread_mutex_lock(&lock);
+	done = 1;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	for (int i = 0; i < 128; ++i) pthread_join(threads[i], 0);
+	return 0;
+}
+EOF
+
+# 100,000 line source file, stopping near the end of it
+{
+	echo "$checkpoint_c"
+	i=0; while [ $i -lt 20000 ]; do
+		echo "int f$i(int x) {"
+		echo "	int y = x + $i;"
+		echo "	return y;"
+		echo "}"
+		echo ""
+		i=$((i + 1))
+	done
+	echo "int main(void) {"
+	echo "	int total = f19999(1);"
+	echo "	checkpoint();"
+	echo "	total += f0(1);"
+	echo "	return total > 0 ? 0 : 1;"
+	echo "}"
+} > $DIR/source.c
+
+cat > $DIR/common.tdbg <<EOF
+b checkpoint
+r
+o
+n
+n
+c
+EOF
+
+printf '%-10s %6s %12s %12s %12s %10s\n' target stops max_cmd_ms max_render_ms lldb_calls max_rss_kb
+for name in locals nested array recursion threads source; do
+	$CC -g -O0 -pthread -o $DIR/$name $DIR/$name.c
+	$TDBG -batch $DIR/common.tdbg $DIR/$name > $DIR/$name.jsonl || true
+
+	stats=$(grep '"type":"stats"' $DIR/$name.jsonl || true)
+	stops=$(echo "$stats" | sed -n 's/.*"stops":\([0-9]*\).*/\1/p')
+	rss=$(echo "$stats" | sed -n 's/.*"max_rss_kb":\([0-9]*\).*/\1/p')
+	max_cmd=$(grep -o '"command_ms":[0-9.]*' $DIR/$name.jsonl | cut -d: -f2 | sort -n | tail -1)
+	max_render=$(grep -o '"render_ms":[0-9.]*' $DIR/$name.jsonl | cut -d: -f2 | sort -n | tail -1)
+	calls=$(grep -o '"lldb_calls":[0-9]*' $DIR/$name.jsonl | cut -d: -f2 | awk '{ s += $1 } END { print s + 0 }')
+	if grep -q '"type":"error"' $DIR/$name.jsonl; then name="$name!"; fi
+
+	printf '%-10s %6s %12s %12s %12s %10s\n' "$name" "${stops:-0}" "${max_cmd:--}" "${max_render:--}" "$calls" "${rss:--}"
+done
+
+echo
+echo "Full records are in $DIR/*.jsonl, targets marked with ! reported errors."
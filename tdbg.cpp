@@ -3,17 +3,44 @@
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <fstream>
 #include <vector>
 #include <algorithm>
 #include <fcntl.h>
 #include <unistd.h>
-#include <iomanip>
 #include <ctime>
+#include <fstream>
 #include <sstream>
-
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <poll.h>
+#include <climits>
+#include <memory>
+#include <unordered_set>
+#include <unordered_map>
+#include <list>
+#include <string_view>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+// termbox writes straight to the tty, so route its write() calls through a
+// counter to report how many bytes each tb_present() sends.
+static size_t tty_bytes_written = 0;
+static ssize_t counting_write(int fd, const void* buf, size_t count);
+#define write counting_write
 #define TB_IMPL
 #include "termbox2.h"
+#undef write
+
+static ssize_t counting_write(int fd, const void* buf, size_t count) {
+	ssize_t written = write(fd, buf, count);
+	if (written > 0 && fd == global.wfd) tty_bytes_written += written;
+	return written;
+}
 
 using namespace lldb;
 
@@ -34,9 +61,32 @@ enum InputMode {
 	INPUT_MODE_BREAKPOINT,
 	INPUT_MODE_VARIABLE,
 	INPUT_MODE_WATCH,
+	INPUT_MODE_WATCHPOINT,
+	INPUT_MODE_MEMORY,
 	INPUT_MODE_HELP
 };
 
+// Views sharing the lower sidebar pane, cycled with Tab
+enum SidebarTab {
+	TAB_WATCH,
+	TAB_STACK,
+	TAB_THREADS,
+	TAB_WATCHPOINTS,
+	TAB_REGISTERS,
+	TAB_COUNT
+};
+
+const char* TAB_NAMES[TAB_COUNT] = {"Watch", "Stack", "Threads", "Watchpoints", "Registers"};
+
+std::string sidebar_title(SidebarTab active) {
+	std::string title;
+	for (int i = 0; i < TAB_COUNT; ++i) {
+		if (i > 0) title += " ";
+		title += (i == active) ? "[" + std::string(TAB_NAMES[i]) + "]" : TAB_NAMES[i];
+	}
+	return title;
+}
+
 struct LLDBGuard {
 	LLDBGuard() { SBDebugger::Initialize(); }
 	~LLDBGuard() { SBDebugger::Terminate(); }
@@ -47,21 +97,291 @@ struct TermboxGuard {
 	~TermboxGuard() { tb_shutdown(); }
 };
 
-struct SourceCache {
+// LLDB runs in async mode, so process state changes arrive as events on the
+// debugger listener. A worker thread blocks on the listener and wakes the main
+// loop through a self-pipe, which lets us poll() the terminal and LLDB at once.
+struct EventPump {
+	SBListener listener;
+	SBBroadcaster wakeup;
+	int pipe_fds[2] = {-1, -1};
+	std::thread worker;
+	std::mutex mutex;
+	std::deque<SBEvent> queue;
+	std::atomic<bool> stopping{false};
+
+	explicit EventPump(SBListener l) : listener(l), wakeup("tdbg.wakeup") {
+		if (pipe(pipe_fds) == 0) {
+			fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+			fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK);
+		}
+		listener.StartListeningForEvents(wakeup, 1);
+		worker = std::thread([this] { run(); });
+	}
+
+	~EventPump() {
+		stopping = true;
+		wakeup.BroadcastEventByType(1);
+		if (worker.joinable()) worker.join();
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+	}
+
+	void run() {
+		while (!stopping) {
+			SBEvent event;
+			if (!listener.WaitForEvent(UINT32_MAX, event)) continue;
+			if (event.BroadcasterMatchesRef(wakeup)) continue;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queue.push_back(event);
+			}
+			char c = 1;
+			(void)!write(pipe_fds[1], &c, 1);
+		}
+	}
+
+	int fd() const { return pipe_fds[0]; }
+
+	// Wakes the main loop for something that isn't an LLDB event
+	void notify() {
+		char c = 1;
+		(void)!write(pipe_fds[1], &c, 1);
+	}
+
+	bool pop(SBEvent& event) {
+		char buf[64];
+		while (read(pipe_fds[0], buf, sizeof(buf)) > 0) {}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.empty()) return false;
+		event = queue.front();
+		queue.pop_front();
+		return true;
+	}
+};
+
+// Creates the target on a worker thread so the UI comes up right away.
+// CreateTarget parses the whole binary and its debug info, which takes a long
+// time for large programs. LLDB reports progress through debugger events.
+struct TargetLoader {
+	std::thread worker;
+	std::atomic<bool> finished{false};
+	bool collected = false;
+	SBTarget target;
+
+	TargetLoader(SBDebugger debugger, const std::string& path, EventPump& pump) {
+		worker = std::thread([this, debugger, path, &pump]() mutable {
+			target = debugger.CreateTarget(path.c_str());
+			finished = true;
+			pump.notify();
+		});
+	}
+
+	// CreateTarget can't be cancelled, quitting while loading waits for it
+	~TargetLoader() {
+		if (worker.joinable()) worker.join();
+	}
+
+	bool loading() const { return !collected; }
+
+	// Hands over the target once the worker is done, true exactly once
+	bool collect(SBTarget& out) {
+		if (collected || !finished) return false;
+		worker.join();
+		collected = true;
+		out = target;
+		return true;
+	}
+};
+
+// Latest debugger progress report, such as symbol loading or indexing
+struct ProgressState {
+	std::string title;
+	uint64_t completed = 0;
+	uint64_t total = 0;
+	bool active = false;
+
+	void update(const SBEvent& event) {
+		uint64_t id = 0;
+		bool debugger_specific = false;
+		const char* message = SBDebugger::GetProgressFromEvent(event, id, completed, total, debugger_specific);
+		title = message ? message : "";
+		active = completed < total;
+	}
+
+	std::string text() const {
+		if (!active) return "";
+		// Progress of unknown length reports UINT64_MAX as total
+		if (total == UINT64_MAX || total <= 1) return title;
+		return title + " (" + std::to_string(completed) + "/" + std::to_string(total) + ")";
+	}
+};
+
+// Decodes one UTF-8 sequence starting at text[i] and advances i past it.
+// Malformed or truncated sequences decode to U+FFFD.
+uint32_t decode_utf8(const char* text, size_t len, size_t& i) {
+	unsigned char c = text[i];
+	if (c < 0x80) {
+		i++;
+		return c;
+	}
+
+	int extra = ((c & 0xE0) == 0xC0) ? 1 : ((c & 0xF0) == 0xE0) ? 2 : ((c & 0xF8) == 0xF0) ? 3 : -1;
+	if (extra < 0 || i + extra >= len) {
+		i++;
+		return 0xFFFD;
+	}
+
+	uint32_t cp = c & (0x3F >> extra);
+	for (int k = 1; k <= extra; ++k) {
+		unsigned char cc = text[i + k];
+		if ((cc & 0xC0) != 0x80) {
+			i++;
+			return 0xFFFD;
+		}
+		cp = (cp << 6) | (cc & 0x3F);
+	}
+	i += extra + 1;
+	return cp;
+}
+
+// A terminal cell ready to blit: a decoded codepoint and its column width.
+struct DisplayCell {
+	uint32_t ch;
+	uint8_t width;
+};
+
+// A source file mapped read-only into memory with the start offset of every
+// line, so any line is available in O(1) without copying it onto the heap.
+struct SourceFile {
 	std::string path;
-	std::vector<std::string> lines;
-
-	const std::vector<std::string>& get_lines(const std::string& fullpath) {
-		if (path != fullpath) {
-			path = fullpath;
-			lines.clear();
-			std::ifstream file(fullpath);
-			std::string line;
-			while (std::getline(file, line)) {
-				lines.push_back(line);
+	bool missing = false;
+	const char* data = nullptr;
+	size_t size = 0;
+	off_t file_size = 0;
+	time_t mtime = 0;
+	std::vector<size_t> line_offsets;
+
+	SourceFile(const std::string& fullpath) : path(fullpath) {
+		int fd = open(fullpath.c_str(), O_RDONLY);
+		if (fd == -1) {
+			missing = true;
+			return;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) == 0) {
+			file_size = st.st_size;
+			mtime = st.st_mtime;
+		}
+		if (file_size > 0) {
+			void* mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED) {
+				data = (const char*)mapped;
+				size = file_size;
+			}
+		}
+		close(fd);
+
+		for (size_t pos = 0; pos < size;) {
+			line_offsets.push_back(pos);
+			const char* nl = (const char*)memchr(data + pos, '\n', size - pos);
+			if (!nl) break;
+			pos = nl - data + 1;
+		}
+	}
+
+	~SourceFile() {
+		if (data) munmap((void*)data, size);
+	}
+
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+
+	size_t line_count() const { return line_offsets.size(); }
+
+	// A rebuild may rewrite the file in place, and reading mapped pages past
+	// a new, shorter end of file raises SIGBUS
+	bool changed_on_disk() const {
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) return !missing;
+		return missing || st.st_size != file_size || st.st_mtime != mtime;
+	}
+
+	std::string_view line(size_t idx) const {
+		size_t start = line_offsets[idx];
+		size_t end = (idx + 1 < line_offsets.size()) ? line_offsets[idx + 1] : size;
+		while (end > start && (data[end - 1] == '\n' || data[end - 1] == '\r')) end--;
+		return std::string_view(data + start, end - start);
+	}
+
+	// Tab-expanded, decoded cells of a line. Built the first time the line is
+	// shown and kept with the file, so redraws blit without allocating.
+	const std::vector<DisplayCell>& display_line(size_t idx) {
+		auto it = display_lines.find(idx);
+		if (it != display_lines.end()) return it->second;
+
+		std::vector<DisplayCell>& cells = display_lines[idx];
+		std::string_view text = line(idx);
+		for (size_t i = 0; i < text.size();) {
+			if (text[i] == '\t') {
+				for (int k = 0; k < 4; ++k) cells.push_back({' ', 1});
+				i++;
+				continue;
+			}
+
+			uint32_t cp = decode_utf8(text.data(), text.size(), i);
+			int width = tb_wcwidth(cp);
+			if (width == 0) continue; // combining marks have no cell of their own
+			if (width < 0) {
+				cp = 0xFFFD;
+				width = 1;
+			}
+			cells.push_back({cp, (uint8_t)width});
+		}
+		display_bytes += cells.size() * sizeof(DisplayCell);
+		return cells;
+	}
+
+	size_t footprint() const { return size + line_offsets.size() * sizeof(size_t) + display_bytes; }
+
+private:
+	std::unordered_map<size_t, std::vector<DisplayCell>> display_lines;
+	size_t display_bytes = 0;
+};
+
+// LRU of mapped source files bounded by a byte budget. The most recently used
+// file is never evicted, even if it alone exceeds the budget.
+struct SourceCache {
+	size_t byte_budget = 64 * 1024 * 1024;
+	size_t bytes_used = 0;
+	std::list<std::unique_ptr<SourceFile>> files;
+	std::unordered_map<std::string, std::list<std::unique_ptr<SourceFile>>::iterator> by_path;
+
+	SourceFile& get(const std::string& fullpath) {
+		auto it = by_path.find(fullpath);
+		if (it != by_path.end()) {
+			if (!(*it->second)->changed_on_disk()) {
+				files.splice(files.begin(), files, it->second);
+				return *files.front();
 			}
+			files.erase(it->second);
+			by_path.erase(it);
+		}
+
+		files.push_front(std::make_unique<SourceFile>(fullpath));
+		by_path[fullpath] = files.begin();
+
+		// Display lines grow after a file is loaded, so recount on every insert
+		bytes_used = 0;
+		for (const auto& file : files) bytes_used += file->footprint();
+
+		while (bytes_used > byte_budget && files.size() > 1) {
+			bytes_used -= files.back()->footprint();
+			by_path.erase(files.back()->path);
+			files.pop_back();
 		}
-		return lines;
+		return *files.front();
 	}
 };
 
@@ -70,24 +390,276 @@ struct VarLine {
 	int indent;
 	int prefix_start;
 	int prefix_end;
+	bool changed = false;
+	std::string value;  // formatted value, what changes are detected on
+};
+
+enum Pane {
+	PANE_SOURCE,
+	PANE_LOCALS,
+	PANE_WATCH,
+	PANE_LOG,
+	PANE_BREAKPOINTS,
+	PANE_STATUS,
+	PANE_COUNT
+};
+
+// Panes are only repainted when something they show changed, and the frame
+// is only presented when at least one pane was repainted. Layout changes
+// clear the whole screen since pane borders move.
+struct DirtyPanes {
+	bool dirty[PANE_COUNT];
+	bool clear_screen = true;
+
+	DirtyPanes() { mark_all(); }
+
+	void mark(Pane pane) { dirty[pane] = true; }
+
+	void mark_all() {
+		for (int i = 0; i < PANE_COUNT; ++i) dirty[i] = true;
+	}
+
+	void relayout() {
+		clear_screen = true;
+		mark_all();
+	}
+
+	bool take(Pane pane) {
+		bool was_dirty = dirty[pane];
+		dirty[pane] = false;
+		return was_dirty;
+	}
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string format_ms(double ms) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.2f ms", ms);
+	return buf;
+}
+
+enum LLDBCall {
+	LLDB_GET_VARIABLES,
+	LLDB_EVALUATE_EXPRESSION,
+	LLDB_VARIABLE_PATH,
+	LLDB_CHILD_AT_INDEX,
+	LLDB_READ_INSTRUCTIONS,
+	LLDB_BREAKPOINTS,
+	LLDB_FRAME_AT_INDEX,
+	LLDB_THREADS,
+	LLDB_READ_MEMORY,
+	LLDB_REGISTERS,
+	LLDB_CALL_COUNT
+};
+
+const char* PANE_NAMES[PANE_COUNT] = {"Source", "Locals", "Watch", "Log", "Breakpoints", "Status"};
+const char* LLDB_CALL_NAMES[LLDB_CALL_COUNT] = {"GetVariables", "EvaluateExpression", "VariablePath", "GetChildAtIndex", "ReadInstructions", "Breakpoints", "GetFrameAtIndex", "Threads", "ReadMemory", "GetRegisters"};
+
+struct FrameSample {
+	double pane_ms[PANE_COUNT] = {};
+	double lldb_ms[LLDB_CALL_COUNT] = {};
+	uint64_t lldb_calls[LLDB_CALL_COUNT] = {};
+	uint64_t present_bytes = 0;
+};
+
+// Timing counters for the stats HUD. Samples are kept for the last
+// HISTORY presented frames, plus totals for the whole session.
+struct Stats {
+	static const int HISTORY = 60;
+	FrameSample current;
+	FrameSample history[HISTORY];
+	FrameSample totals;
+	uint64_t frames = 0;
+
+	void end_frame() {
+		history[frames % HISTORY] = current;
+		for (int i = 0; i < PANE_COUNT; ++i) totals.pane_ms[i] += current.pane_ms[i];
+		for (int i = 0; i < LLDB_CALL_COUNT; ++i) {
+			totals.lldb_ms[i] += current.lldb_ms[i];
+			totals.lldb_calls[i] += current.lldb_calls[i];
+		}
+		totals.present_bytes += current.present_bytes;
+		frames++;
+		current = FrameSample();
+	}
+
+	int window() const { return (int)std::min<uint64_t>(frames, HISTORY); }
+
+	// Average of the last window() frames
+	FrameSample average() const {
+		FrameSample avg;
+		int n = window();
+		if (n == 0) return avg;
+		for (int f = 0; f < n; ++f) {
+			const FrameSample& s = history[f];
+			for (int i = 0; i < PANE_COUNT; ++i) avg.pane_ms[i] += s.pane_ms[i] / n;
+			for (int i = 0; i < LLDB_CALL_COUNT; ++i) {
+				avg.lldb_ms[i] += s.lldb_ms[i] / n;
+				avg.lldb_calls[i] += s.lldb_calls[i];
+			}
+			avg.present_bytes += s.present_bytes;
+		}
+		for (int i = 0; i < LLDB_CALL_COUNT; ++i) avg.lldb_calls[i] /= n;
+		avg.present_bytes /= n;
+		return avg;
+	}
+
+	double max_pane_ms(int pane) const {
+		double max = 0;
+		for (int f = 0; f < window(); ++f) max = std::max(max, history[f].pane_ms[pane]);
+		return max;
+	}
+
+	void dump(std::ostream& out) const {
+		out << "tdbg stats over " << frames << " frames\n";
+		for (int i = 0; i < PANE_COUNT; ++i) {
+			out << "  draw " << PANE_NAMES[i] << ": " << format_ms(totals.pane_ms[i]) << "\n";
+		}
+		for (int i = 0; i < LLDB_CALL_COUNT; ++i) {
+			out << "  lldb " << LLDB_CALL_NAMES[i] << ": " << totals.lldb_calls[i] << " calls, " << format_ms(totals.lldb_ms[i]) << "\n";
+		}
+		out << "  tb_present: " << totals.present_bytes << " bytes\n";
+	}
+} stats;
+
+// Attributes the time spent in its scope to an LLDB call category
+struct LLDBTimer {
+	LLDBCall call;
+	std::chrono::steady_clock::time_point start;
+
+	explicit LLDBTimer(LLDBCall c) : call(c), start(std::chrono::steady_clock::now()) {}
+	~LLDBTimer() {
+		stats.current.lldb_ms[call] += elapsed_ms(start);
+		stats.current.lldb_calls[call]++;
+	}
 };
 
-std::string get_timestamp() {
-	auto now = std::chrono::system_clock::now();
-	std::time_t now_c = std::chrono::system_clock::to_time_t(now);
-	std::tm now_tm = *std::localtime(&now_c);
-	std::stringstream ss;
-	ss << std::put_time(&now_tm, "%H:%M:%S");
-	return ss.str();
+std::string format_timestamp(std::time_t time) {
+	std::tm tm_local;
+	localtime_r(&time, &tm_local);
+	char buf[16];
+	strftime(buf, sizeof(buf), "%H:%M:%S", &tm_local);
+	return buf;
 }
 
-void log_msg(std::vector<std::string>& log_buffer, const std::string& msg) {
-	log_buffer.push_back(get_timestamp() + " " + msg);
+struct LogRecord {
+	std::time_t time = 0;
+	std::string text;
+};
+
+// Appends records that fell out of the log ring to stderr (tdbg.log) on a
+// background thread, so the UI thread never blocks on the file.
+struct LogSpill {
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::vector<LogRecord> pending;
+	bool stopping = false;
+	std::thread worker;
+
+	LogSpill() : worker([this] { run(); }) {}
+
+	~LogSpill() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		ready.notify_one();
+		worker.join();
+	}
+
+	void push(const LogRecord& record) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.push_back(record);
+		}
+		ready.notify_one();
+	}
+
+private:
+	void run() {
+		std::vector<LogRecord> batch;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			ready.wait(lock, [this] { return stopping || !pending.empty(); });
+			if (pending.empty() && stopping) return;
+			batch.swap(pending);
+			lock.unlock();
+
+			std::string out;
+			for (const LogRecord& record : batch) {
+				out += format_timestamp(record.time) + " " + record.text + "\n";
+			}
+			for (size_t done = 0; done < out.size();) {
+				ssize_t n = write(STDERR_FILENO, out.data() + done, out.size() - done);
+				if (n <= 0) break;
+				done += n;
+			}
+			batch.clear();
+			lock.lock();
+		}
+	}
+};
+
+// Fixed capacity ring of log records. Slots are reused once the ring is full,
+// so an append does not allocate unless the text outgrows the old slot.
+// Timestamps are kept raw and only formatted when a line is drawn.
+struct LogBuffer {
+	std::vector<LogRecord> records;
+	size_t head = 0;
+	size_t count = 0;
+	uint64_t appended = 0;
+	std::unique_ptr<LogSpill> spill;
+
+	explicit LogBuffer(size_t capacity) : records(std::max<size_t>(1, capacity)) {}
+
+	size_t size() const { return count; }
+
+	// Index 0 is the oldest record still kept
+	const LogRecord& operator[](size_t idx) const { return records[(head + idx) % records.size()]; }
+
+	std::string line(size_t idx) const {
+		const LogRecord& record = (*this)[idx];
+		return format_timestamp(record.time) + " " + record.text;
+	}
+
+	void push(const std::string& text, std::time_t time = std::time(nullptr)) {
+		LogRecord* slot;
+		if (count < records.size()) {
+			slot = &records[(head + count) % records.size()];
+			count++;
+		} else {
+			slot = &records[head];
+			if (spill) spill->push(*slot);
+			head = (head + 1) % records.size();
+		}
+		slot->time = time;
+		slot->text.assign(text);
+		appended++;
+	}
+};
+
+void log_msg(LogBuffer& log_buffer, const std::string& msg) {
+	log_buffer.push(msg);
 }
 
 void draw_text(int x, int y, uint16_t fg, uint16_t bg, const std::string& text) {
-	for (char c : text) {
-		tb_set_cell(x++, y, c, fg, bg);
+	for (size_t i = 0; i < text.size();) {
+		uint32_t cp = decode_utf8(text.data(), text.size(), i);
+		int width = tb_wcwidth(cp);
+		if (width == 0) continue;
+		tb_set_cell(x, y, cp, fg, bg);
+		x += std::max(1, width);
+	}
+}
+
+void clear_rect(int x, int y, int w, int h) {
+	for (int i = 0; i < h; ++i) {
+		for (int j = 0; j < w; ++j) {
+			tb_set_cell(x + j, y + i, ' ', TB_DEFAULT, TB_DEFAULT);
+		}
 	}
 }
 
@@ -162,286 +734,1214 @@ char get_type_char(SBType type) {
 	return '?';
 }
 
-void collect_variables_recursive(SBValue val, int indent, std::vector<VarLine>& lines, int width, const std::string& name_override = "") {
-	if (indent > 3) return;
-
-	std::string original_name = name_override.empty() ? (val.GetName() ? val.GetName() : "") : name_override;
-	char type_char = get_type_char(val.GetType());
-	std::string prefix = std::string("(") + type_char + ") ";
+std::string format_value(SBValue val) {
+	if (!val.IsValid()) return "(invalid)";
 
 	std::string val_str = val.GetValue() ? val.GetValue() : "";
 	std::string summary_str = val.GetSummary() ? val.GetSummary() : "";
-	std::string value;
+	if (!val_str.empty() && !summary_str.empty()) return val_str + " " + summary_str;
+	if (!val_str.empty()) return val_str;
+	return summary_str;
+}
 
-	if (!val.IsValid()) value = "(invalid)";
-	else {
-		if (!val_str.empty() && !summary_str.empty()) value = val_str + " " + summary_str;
-		else if (!val_str.empty()) value = val_str;
-		else if (!summary_str.empty()) value = summary_str;
-	}
+void format_variable_log(SBValue val, LogBuffer& log_buffer, int indent, const std::string& name_override = "") {
+	if (indent > 3) return;
 
-	std::string indent_str(indent * 2, ' ');
-	std::string content = original_name;
-	if (!value.empty()) content += " = " + value;
+	std::string name = name_override.empty() ? (val.GetName() ? val.GetName() : "") : name_override;
+	char type_char = get_type_char(val.GetType());
+
+	std::string value = format_value(val);
 
-	std::string line_text = indent_str + prefix + content;
-	if ((int)line_text.length() > width) line_text = line_text.substr(0, width - 3) + "...";
+	std::string indent_str(indent * 2, ' ');
+	std::string line = indent_str + "(" + type_char + ") " + name;
+	if (!value.empty()) line += " = " + value;
 
-	VarLine vl;
-	vl.text = line_text;
-	vl.indent = indent;
-	vl.prefix_start = indent * 2;
-	vl.prefix_end = vl.prefix_start + 4; // length of "(x) "
-	lines.push_back(vl);
+	log_msg(log_buffer, line);
 
 	if (val.GetNumChildren() > 0) {
 		uint32_t n = val.GetNumChildren();
 		for (uint32_t i = 0; i < n; ++i) {
-			collect_variables_recursive(val.GetChildAtIndex(i), indent + 1, lines, width);
+			SBValue child;
+			{
+				LLDBTimer timer(LLDB_CHILD_AT_INDEX);
+				child = val.GetChildAtIndex(i);
+			}
+			format_variable_log(child, log_buffer, indent + 1);
 		}
 	}
 }
 
-void format_variable_log(SBValue val, std::vector<std::string>& log_buffer, int indent, const std::string& name_override = "") {
-	if (indent > 3) return;
+// Vector registers (xmm/ymm/zmm) as one hex number per 64 bit lane, most
+// significant lane first. Their per element children would cost an SBValue
+// each, and reading them that way is rarely what anyone wants.
+bool is_vector_value(SBValue val) {
+	return val.GetType().IsVectorType();
+}
 
-	std::string name = name_override.empty() ? (val.GetName() ? val.GetName() : "") : name_override;
-	char type_char = get_type_char(val.GetType());
+std::string format_vector(SBValue val) {
+	SBData data = val.GetData();
+	size_t lanes = data.GetByteSize() / 8;
+	if (lanes == 0) return format_value(val);
 
-	std::string val_str = val.GetValue() ? val.GetValue() : "";
-	std::string summary_str = val.GetSummary() ? val.GetSummary() : "";
-	std::string value;
+	std::string text;
+	bool zero = true;
+	for (size_t i = lanes; i-- > 0;) {
+		SBError error;
+		uint64_t lane = data.GetUnsignedInt64(error, i * 8);
+		if (lane) zero = false;
+		char buf[24];
+		snprintf(buf, sizeof(buf), text.empty() ? "0x%016lx" : "_%016lx", (unsigned long)lane);
+		text += buf;
+	}
+	return zero ? "0" : text;
+}
 
-	if (!val.IsValid()) value = "(invalid)";
-	else {
-		if (!val_str.empty() && !summary_str.empty()) value = val_str + " " + summary_str;
-		else if (!val_str.empty()) value = val_str;
-		else if (!summary_str.empty()) value = summary_str;
+const uint32_t CHILD_PAGE_SIZE = 100;
+
+// One row of a lazily expanded variable tree. Child values are only fetched
+// from LLDB when the row is about to be drawn, and aggregates with more than
+// CHILD_PAGE_SIZE children are split into page rows like "[0..99] of 1000".
+struct VarNode {
+	SBValue value;
+	SBValue parent;      // aggregate this node (or page) indexes into
+	uint32_t index = 0;  // child index in parent, first index for pages
+	uint32_t count = 0;  // pages: number of children covered
+	uint32_t total = 0;  // pages: number of children of the aggregate
+	bool is_page = false;
+	bool resolved = false;
+	bool has_line = false;
+	bool expanded = false;
+	bool children_built = false;
+	int indent = 0;
+	std::string name;
+	std::string path;       // stable key such as "rect.top_left.x"
+	std::string child_base; // path prefix handed to children
+	std::string error;      // set for watch expressions that failed
+	VarLine line;
+	std::vector<std::unique_ptr<VarNode>> children;
+};
+
+// Values read for one frame, keyed by path. previous holds the values of the
+// stop before, which is what changed rows are compared against.
+struct ValueHistory {
+	uint32_t stop_id = UINT32_MAX;
+	std::unordered_map<std::string, std::string> values;
+	std::unordered_map<std::string, std::string> previous;
+
+	// What was read at the last stop becomes the baseline for the new one
+	void at_stop(uint32_t id) {
+		if (id == stop_id) return;
+		stop_id = id;
+		previous = std::move(values);
+		values.clear();
 	}
 
-	std::string indent_str(indent * 2, ' ');
-	std::string line = get_timestamp() + " " + indent_str + "(" + type_char + ") " + name;
-	if (!value.empty()) line += " = " + value;
+	void clear() {
+		stop_id = UINT32_MAX;
+		values.clear();
+		previous.clear();
+	}
 
-	log_buffer.push_back(line);
+	// Records a drawn value and reports whether it differs from the baseline
+	bool record(const std::string& path, const std::string& value) {
+		values[path] = value;
+		auto prev = previous.find(path);
+		return prev != previous.end() && prev->second != value;
+	}
+};
 
-	if (val.GetNumChildren() > 0) {
-		uint32_t n = val.GetNumChildren();
-		for (uint32_t i = 0; i < n; ++i) {
-			format_variable_log(val.GetChildAtIndex(i), log_buffer, indent + 1);
-		}
+struct VarTree {
+	std::vector<std::unique_ptr<VarNode>> roots;
+	// Expansion state is keyed by path so it survives rebuilding the tree
+	std::unordered_set<std::string> expanded_paths;
+	ValueHistory history;
+	bool compact_vectors = false;
+
+	void clear() { roots.clear(); }
+
+	// Keeps the nodes for another stop of the same frame. LLDB updates the
+	// values in place. Rows whose value reports a change (and pointers, whose
+	// summaries depend on the pointee) are formatted again once they are
+	// drawn, nothing is formatted here. Unchanged rows carry their value over
+	// into this stop, so the next stop compares against it.
+	void refresh() {
+		for (auto& node : roots) refresh(*node);
 	}
-}
 
-void draw_variables_view(SBFrame &frame, int x, int y, int w, int h, int scroll_offset) {
-	draw_box(x, y, w, h, "Locals");
+	void add_root(SBValue value, const std::string& name_override = "") {
+		auto node = std::make_unique<VarNode>();
+		node->value = value;
+		node->name = name_override;
+		roots.push_back(std::move(node));
+	}
 
-	// Content area
-	int cx = x + 1;
-	int cy = y + 1;
-	int ch = h - 2;
-	int cw = w - 2;
+	void add_error(const std::string& name, const std::string& error) {
+		auto node = std::make_unique<VarNode>();
+		node->name = name;
+		node->error = error;
+		roots.push_back(std::move(node));
+	}
 
-	if (!frame.IsValid()) {
-		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No frame selected.");
-		return;
+	int row_count() {
+		int rows = 0;
+		for (auto& node : roots) rows += count_rows(*node, "", !expanded_paths.empty());
+		return rows;
 	}
 
-	std::vector<VarLine> lines;
-	SBValueList vars = frame.GetVariables(true, true, false, true);
-	for (uint32_t i = 0; i < vars.GetSize(); ++i) {
-		collect_variables_recursive(vars.GetValueAtIndex(i), 0, lines, cw);
+	// Collects the rows in [first, first + count), fetching only those from LLDB
+	void visible_rows(int first, int count, std::vector<VarNode*>& out) {
+		int row = 0;
+		walk(roots, "", !expanded_paths.empty(), row, first, first + count, out);
+		for (VarNode* node : out) build_line(*node);
 	}
 
-	int total_lines = (int)lines.size();
-	int display_count = std::min(total_lines, ch);
+	VarNode* row_at(int row) {
+		std::vector<VarNode*> out;
+		visible_rows(row, 1, out);
+		return out.empty() ? nullptr : out[0];
+	}
 
-	for (int i = 0; i < display_count; ++i) {
-		int line_idx = scroll_offset + i;
-		if (line_idx < 0 || line_idx >= total_lines) continue;
+	void toggle(VarNode& node) {
+		if (!node.is_page && !has_children(node)) return;
+		node.expanded = !node.expanded;
+		node.has_line = false;
+		if (node.expanded) expanded_paths.insert(node.path);
+		else expanded_paths.erase(node.path);
+	}
 
-		const VarLine& vl = lines[line_idx];
-		for (int j = 0; j < (int)vl.text.length() && j < cw; ++j) {
-			uint16_t fg = TB_DEFAULT;
-			if (j >= vl.prefix_start && j < vl.prefix_end) {
-				fg = TB_BLACK | TB_BOLD;
+private:
+	void refresh(VarNode& node) {
+		if (!node.is_page && node.resolved && node.has_line && node.value.IsValid()) {
+			if (node.value.GetType().IsPointerType() || node.value.GetValueDidChange()) {
+				node.has_line = false;
+			} else {
+				node.line.changed = false;
+				history.values[node.path] = node.line.value;
+			}
+		}
+		if (!node.is_page && node.resolved && node.value.IsValid()) {
+			// Containers like std::vector can grow between stops
+			if (node.children_built) {
+				uint32_t n = node.value.GetNumChildren();
+				bool paged = !node.children.empty() && node.children[0]->is_page;
+				uint32_t built = paged ? node.children[0]->total : (uint32_t)node.children.size();
+				if (n != built) {
+					node.children.clear();
+					node.children_built = false;
+				}
 			}
-			tb_set_cell(cx + j, cy + i, vl.text[j], fg, TB_DEFAULT);
 		}
+		for (auto& child : node.children) refresh(*child);
 	}
 
-	// Draw scrollbar
-	if (total_lines > ch) {
-		int thumb_height = std::max(1, (ch * ch) / total_lines);
-		int max_scroll = total_lines - ch;
-		double scroll_percent = (double)scroll_offset / (double)max_scroll;
-		int thumb_pos = (ch - thumb_height) * scroll_percent;
+	bool has_children(VarNode& node) {
+		if (compact_vectors && is_vector_value(node.value)) return false;
+		return node.value.MightHaveChildren();
+	}
 
-		for (int i = 0; i < ch; ++i) {
-			uint32_t cell_char = SCROLLBAR_LINE;
-			uint16_t fg = TB_DEFAULT;
-			if (i >= thumb_pos && i < thumb_pos + thumb_height) {
-				cell_char = SCROLLBAR_THUMB;
-				fg = TB_WHITE;
-			}
-			tb_set_cell(x + w - 1, cy + i, cell_char, fg, TB_DEFAULT);
+	bool has_expanded_below(const std::string& base) const {
+		for (const auto& path : expanded_paths) {
+			if (path.size() > base.size() && path.compare(0, base.size(), base) == 0) return true;
 		}
+		return false;
 	}
-}
-
-std::string get_breakpoint_name(SBBreakpoint bp) {
-	if (!bp.IsValid()) return "???";
 
-	std::string name = "???";
-	if (bp.GetNumLocations() > 0) {
-		SBBreakpointLocation loc = bp.GetLocationAtIndex(0);
-		SBAddress addr = loc.GetAddress();
+	void resolve(VarNode& node, const std::string& base) {
+		if (node.resolved) return;
+		node.resolved = true;
 
-		SBFunction func = addr.GetFunction();
-		if (func.IsValid()) {
-			const char* n = func.GetName();
-			if (n) name = n;
+		if (node.is_page) {
+			node.name = "[" + std::to_string(node.index) + ".." + std::to_string(node.index + node.count - 1) + "]";
+			node.path = base + node.name;
+			node.child_base = base;
 		} else {
-			SBSymbol sym = addr.GetSymbol();
-			if (sym.IsValid()) {
-				const char* n = sym.GetName();
-				if (n) name = n;
+			if (!node.value.IsValid() && node.parent.IsValid()) {
+				LLDBTimer timer(LLDB_CHILD_AT_INDEX);
+				node.value = node.parent.GetChildAtIndex(node.index);
 			}
+			if (node.name.empty()) node.name = node.value.GetName() ? node.value.GetName() : "";
+			if (base.empty() || node.name.empty() || node.name[0] == '[') node.path = base + node.name;
+			else node.path = base + "." + node.name;
+			node.child_base = node.path;
 		}
+		node.expanded = expanded_paths.count(node.path) > 0;
+	}
 
-		SBLineEntry line_entry = addr.GetLineEntry();
-		if (line_entry.IsValid()) {
-			std::string file_name;
-			SBFileSpec fs = line_entry.GetFileSpec();
-			if (fs.IsValid()) file_name = fs.GetFilename();
-
-			if (name == "???") {
-				if (!file_name.empty()) name = file_name + ":" + std::to_string(line_entry.GetLine());
-			} else {
-				if (!file_name.empty()) name += " (" + file_name + ":" + std::to_string(line_entry.GetLine()) + ")";
+	void build_children(VarNode& node) {
+		if (node.children_built) return;
+		node.children_built = true;
+
+		SBValue aggregate = node.is_page ? node.parent : node.value;
+		uint32_t first = node.is_page ? node.index : 0;
+		uint32_t n = node.is_page ? node.count : aggregate.GetNumChildren();
+
+		if (!node.is_page && n > CHILD_PAGE_SIZE) {
+			for (uint32_t start = 0; start < n; start += CHILD_PAGE_SIZE) {
+				auto page = std::make_unique<VarNode>();
+				page->is_page = true;
+				page->parent = aggregate;
+				page->index = start;
+				page->count = std::min(CHILD_PAGE_SIZE, n - start);
+				page->total = n;
+				page->indent = node.indent + 1;
+				node.children.push_back(std::move(page));
 			}
+			return;
+		}
+
+		for (uint32_t i = 0; i < n; ++i) {
+			auto child = std::make_unique<VarNode>();
+			child->parent = aggregate;
+			child->index = first + i;
+			child->indent = node.indent + 1;
+			node.children.push_back(std::move(child));
 		}
 	}
-	return name;
-}
 
-void draw_source_view(SBFrame &frame, int x, int y, int w, int h, SourceCache& cache, int scroll_offset) {
-	draw_box(x, y, w, h, "Source");
+	// Nodes have to be resolved to learn their expansion state, but that is
+	// only needed when some expanded path lives below their parent.
+	int count_rows(VarNode& node, const std::string& base, bool need_resolve) {
+		if (need_resolve) resolve(node, base);
+		if (!node.resolved || !node.expanded) return 1;
+
+		build_children(node);
+		bool child_resolve = has_expanded_below(node.child_base);
+		int rows = 1;
+		for (auto& child : node.children) rows += count_rows(*child, node.child_base, child_resolve);
+		return rows;
+	}
+
+	void walk(std::vector<std::unique_ptr<VarNode>>& nodes, const std::string& base, bool need_resolve, int& row, int first, int last, std::vector<VarNode*>& out) {
+		for (auto& node_ptr : nodes) {
+			if (row >= last) return;
+			VarNode& node = *node_ptr;
+
+			int rows = count_rows(node, base, need_resolve);
+			if (row + rows <= first) {
+				row += rows;
+				continue;
+			}
+
+			if (row >= first) {
+				resolve(node, base);
+				out.push_back(&node);
+			}
+			row++;
+
+			if (node.expanded) {
+				build_children(node);
+				walk(node.children, node.child_base, has_expanded_below(node.child_base), row, first, last, out);
+			}
+		}
+	}
+
+	void build_line(VarNode& node) {
+		if (node.has_line) return;
+		node.has_line = true;
+
+		std::string indent_str(node.indent * 2, ' ');
+		VarLine& vl = node.line;
+		vl.indent = node.indent;
+
+		if (!node.error.empty()) {
+			vl.text = indent_str + node.name + " = " + node.error;
+			vl.prefix_start = 0;
+			vl.prefix_end = 0;
+			return;
+		}
+
+		if (node.is_page) {
+			vl.text = indent_str + (node.expanded ? "- " : "+ ") + node.name + " of " + std::to_string(node.total);
+			vl.prefix_start = 0;
+			vl.prefix_end = 0;
+			return;
+		}
+
+		bool compact = compact_vectors && is_vector_value(node.value);
+		std::string marker = !compact && node.value.MightHaveChildren() ? (node.expanded ? "- " : "+ ") : "  ";
+		std::string value = compact ? format_vector(node.value) : format_value(node.value);
+		vl.value = value;
+		vl.changed = history.record(node.path, value);
+		vl.text = indent_str + marker + "(" + get_type_char(node.value.GetType()) + ") " + node.name;
+		if (!value.empty()) vl.text += " = " + value;
+		vl.prefix_start = node.indent * 2 + 2;
+		vl.prefix_end = vl.prefix_start + 4; // length of "(x) "
+	}
+};
+
+// Identifies the selected frame at a particular stop. Anything derived from
+// it stays valid until the process resumes or another frame is selected.
+struct StopKey {
+	uint64_t pid = 0;
+	uint32_t stop_id = UINT32_MAX;
+	uint64_t thread_id = 0;
+	uint32_t frame_id = UINT32_MAX;
+
+	static StopKey from_frame(SBFrame& frame) {
+		StopKey key;
+		if (!frame.IsValid()) return key;
+
+		SBThread thread = frame.GetThread();
+		SBProcess process = thread.GetProcess();
+		key.pid = process.GetProcessID();
+		key.stop_id = process.GetStopID();
+		key.thread_id = thread.GetThreadID();
+		key.frame_id = frame.GetFrameID();
+		return key;
+	}
+
+	bool operator==(const StopKey& other) const {
+		return pid == other.pid && stop_id == other.stop_id && thread_id == other.thread_id && frame_id == other.frame_id;
+	}
+	bool operator!=(const StopKey& other) const { return !(*this == other); }
+};
+
+// Identifies a frame across stops: the same function at the same CFA on the
+// same thread. Frame indexes shift when stepping into calls, this doesn't.
+std::string frame_identity(SBFrame& frame) {
+	if (!frame.IsValid()) return "";
+	SBThread thread = frame.GetThread();
+	const char* function = frame.GetFunctionName();
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%llu:%llx:", (unsigned long long)thread.GetThreadID(), (unsigned long long)frame.GetCFA());
+	return std::to_string(thread.GetProcess().GetProcessID()) + ":" + buf + (function ? function : "");
+}
+
+// Locals of the selected frame. Drawing, scrolling and resizing reuse the
+// tree until the process runs again or another frame is selected. Lines are
+// kept untruncated so a resize doesn't invalidate them. At the next stop of
+// the same frame the tree is kept and refreshed, and the values drawn for
+// each frame are kept so locals that changed since then are highlighted.
+struct LocalsSnapshot {
+	static const size_t MAX_HISTORIES = 64;
+
+	StopKey key;
+	std::string frame_id;
+	VarTree tree;
+	std::unordered_map<std::string, ValueHistory> histories;
+
+	VarTree& get_tree(SBFrame& frame) {
+		StopKey cur = StopKey::from_frame(frame);
+		if (cur == key) return tree;
+		key = cur;
+
+		std::string id = frame_identity(frame);
+		bool same_frame = !id.empty() && id == frame_id;
+		if (!same_frame) {
+			if (!frame_id.empty()) {
+				if (histories.size() >= MAX_HISTORIES) histories.clear();
+				histories[frame_id] = std::move(tree.history);
+			}
+			tree.history = ValueHistory();
+			auto it = histories.find(id);
+			if (it != histories.end()) {
+				tree.history = std::move(it->second);
+				histories.erase(it);
+			}
+			frame_id = id;
+		}
+
+		if (!frame.IsValid()) {
+			tree.clear();
+			return tree;
+		}
+		tree.history.at_stop(cur.stop_id);
+
+		SBValueList vars;
+		{
+			LLDBTimer timer(LLDB_GET_VARIABLES);
+			vars = frame.GetVariables(true, true, false, true);
+		}
+
+		// Stepping within a scope keeps the same variables, entering or
+		// leaving a block changes them
+		bool same_vars = same_frame && vars.GetSize() == tree.roots.size();
+		for (uint32_t i = 0; same_vars && i < vars.GetSize(); ++i) {
+			const char* name = vars.GetValueAtIndex(i).GetName();
+			const char* old_name = tree.roots[i]->value.GetName();
+			same_vars = name && old_name && strcmp(name, old_name) == 0;
+		}
+
+		if (same_vars) {
+			tree.refresh();
+		} else {
+			tree.clear();
+			for (uint32_t i = 0; i < vars.GetSize(); ++i) {
+				tree.add_root(vars.GetValueAtIndex(i));
+			}
+		}
+		return tree;
+	}
+};
+
+// Plain variable paths like "rect.top_left.x", "ptr->x" or "arr[3]" can be
+// resolved through the frame's variable lookup without invoking clang.
+bool is_variable_path(const std::string& expr) {
+	size_t i = 0;
+	auto ident = [&]() {
+		if (i >= expr.size() || !(isalpha((unsigned char)expr[i]) || expr[i] == '_')) return false;
+		while (i < expr.size() && (isalnum((unsigned char)expr[i]) || expr[i] == '_')) i++;
+		return true;
+	};
+
+	if (!ident()) return false;
+	while (i < expr.size()) {
+		if (expr[i] == '.') {
+			i++;
+			if (!ident()) return false;
+		} else if (expr.compare(i, 2, "->") == 0) {
+			i += 2;
+			if (!ident()) return false;
+		} else if (expr[i] == '[') {
+			size_t start = ++i;
+			while (i < expr.size() && isdigit((unsigned char)expr[i])) i++;
+			if (i == start || i >= expr.size() || expr[i] != ']') return false;
+			i++;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct WatchExpression {
+	std::string text;
+	bool is_path;
+
+	explicit WatchExpression(const std::string& expr) : text(expr), is_path(is_variable_path(expr)) {}
+};
+
+// Resolves simple paths through GetValueForVariablePath and only falls back to
+// the full expression evaluator when that fails. used_path reports which one
+// produced the value.
+SBValue evaluate_expression(SBFrame& frame, const WatchExpression& expr, bool& used_path) {
+	used_path = false;
+	if (expr.is_path) {
+		LLDBTimer timer(LLDB_VARIABLE_PATH);
+		SBValue val = frame.GetValueForVariablePath(expr.text.c_str());
+		if (val.IsValid() && !val.GetError().Fail()) {
+			used_path = true;
+			return val;
+		}
+	}
+	LLDBTimer timer(LLDB_EVALUATE_EXPRESSION);
+	return frame.EvaluateExpression(expr.text.c_str());
+}
+
+// Watch expressions can JIT code and run it in the inferior, so each one is
+// evaluated once per stop. Newly added expressions are evaluated on demand,
+// and invalidate() forces a re-evaluation for the refresh key.
+struct WatchSnapshot {
+	StopKey key;
+	size_t evaluated = 0;
+	VarTree tree;
+
+	VarTree& get_tree(SBFrame& frame, const std::vector<WatchExpression>& expressions, LogBuffer& log_buffer) {
+		StopKey cur = StopKey::from_frame(frame);
+		if (cur != key) {
+			key = cur;
+			invalidate();
+		}
+		if (evaluated >= expressions.size() || !frame.IsValid()) return tree;
+
+		auto start = std::chrono::steady_clock::now();
+		size_t count = expressions.size() - evaluated;
+		size_t by_path = 0;
+		for (; evaluated < expressions.size(); ++evaluated) {
+			const WatchExpression& expr = expressions[evaluated];
+			bool used_path = false;
+			SBValue val = evaluate_expression(frame, expr, used_path);
+			if (used_path) by_path++;
+			if (val.IsValid() && !val.GetError().Fail()) {
+				tree.add_root(val, expr.text);
+			} else {
+				std::string error = "(error)";
+				if (val.GetError().GetCString()) {
+					error += ": " + std::string(val.GetError().GetCString());
+				}
+				tree.add_error(expr.text, error);
+			}
+		}
+
+		log_msg(log_buffer, "Evaluated " + std::to_string(count) + " watch(es), " + std::to_string(by_path) + " by path, in " + format_ms(elapsed_ms(start)));
+		return tree;
+	}
+
+	void invalidate() {
+		evaluated = 0;
+		tree.clear();
+	}
+};
 
+void draw_var_tree(VarTree& tree, int x, int y, int w, int h, int scroll_offset) {
 	int cx = x + 1;
 	int cy = y + 1;
 	int ch = h - 2;
 	int cw = w - 2;
 
+	int total_lines = tree.row_count();
+
+	std::vector<VarNode*> rows;
+	tree.visible_rows(scroll_offset, ch, rows);
+
+	for (int i = 0; i < (int)rows.size(); ++i) {
+		const VarLine& vl = rows[i]->line;
+		bool truncated = (int)vl.text.length() > cw;
+		for (int j = 0; j < (int)vl.text.length() && j < cw; ++j) {
+			uint16_t fg = TB_DEFAULT;
+			if (j >= vl.prefix_start && j < vl.prefix_end) {
+				fg = TB_BLACK | TB_BOLD;
+			} else if (vl.changed && j >= vl.prefix_end) {
+				fg = TB_RED | TB_BOLD;
+			}
+			char c = (truncated && j >= cw - 3) ? '.' : vl.text[j];
+			tb_set_cell(cx + j, cy + i, c, fg, TB_DEFAULT);
+		}
+	}
+
+	// Draw scrollbar
+	if (total_lines > ch) {
+		int thumb_height = std::max(1, (ch * ch) / total_lines);
+		int max_scroll = total_lines - ch;
+		double scroll_percent = (double)scroll_offset / (double)max_scroll;
+		int thumb_pos = (ch - thumb_height) * scroll_percent;
+
+		for (int i = 0; i < ch; ++i) {
+			uint32_t cell_char = SCROLLBAR_LINE;
+			uint16_t fg = TB_DEFAULT;
+			if (i >= thumb_pos && i < thumb_pos + thumb_height) {
+				cell_char = SCROLLBAR_THUMB;
+				fg = TB_WHITE;
+			}
+			tb_set_cell(x + w - 1, cy + i, cell_char, fg, TB_DEFAULT);
+		}
+	}
+}
+
+// Register sets of the selected frame, read once per stop. Sets and their
+// registers are rows of a VarTree, so only the registers on screen are
+// fetched. The values drawn at the previous stop of the same frame are the
+// baseline for highlighting the registers that changed.
+struct RegistersSnapshot {
+	StopKey key;
+	VarTree tree;
+	bool opened = false;
+
+	RegistersSnapshot() { tree.compact_vectors = true; }
+
+	VarTree& get_tree(SBFrame& frame) {
+		StopKey cur = StopKey::from_frame(frame);
+		if (cur == key) return tree;
+
+		bool same_frame = cur.pid == key.pid && cur.thread_id == key.thread_id && cur.frame_id == key.frame_id;
+		if (!same_frame) tree.history.clear();
+		tree.history.at_stop(cur.stop_id);
+		tree.clear();
+		key = cur;
+		if (!frame.IsValid()) return tree;
+
+		LLDBTimer timer(LLDB_REGISTERS);
+		SBValueList sets = frame.GetRegisters();
+		for (uint32_t i = 0; i < sets.GetSize(); ++i) {
+			SBValue set = sets.GetValueAtIndex(i);
+			// General purpose registers start out expanded
+			if (i == 0 && !opened && set.GetName()) tree.expanded_paths.insert(set.GetName());
+			tree.add_root(set);
+		}
+		opened = true;
+		return tree;
+	}
+};
+
+void draw_registers_view(SBFrame& frame, int x, int y, int w, int h, const std::string& title, RegistersSnapshot& snapshot, int scroll_offset) {
+	draw_box(x, y, w, h, title);
+
 	if (!frame.IsValid()) {
-		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No frame selected.");
+		draw_text(x + 1, y + 1, TB_RED, TB_DEFAULT, "No frame selected.");
 		return;
 	}
 
-	SBLineEntry line_entry = frame.GetLineEntry();
-	if (!line_entry.IsValid()) {
-		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No line entry info.");
+	draw_var_tree(snapshot.get_tree(frame), x, y, w, h, scroll_offset);
+}
+
+void draw_variables_view(SBFrame &frame, int x, int y, int w, int h, LocalsSnapshot& snapshot, int scroll_offset) {
+	draw_box(x, y, w, h, "Locals");
+
+	if (!frame.IsValid()) {
+		draw_text(x + 1, y + 1, TB_RED, TB_DEFAULT, "No frame selected.");
 		return;
 	}
 
-	SBFileSpec file_spec = line_entry.GetFileSpec();
-	if (!file_spec.IsValid()) return;
+	draw_var_tree(snapshot.get_tree(frame), x, y, w, h, scroll_offset);
+}
 
-	// Construct full path
-	std::string fullpath;
-	if (file_spec.GetDirectory()) {
-		fullpath = std::string(file_spec.GetDirectory()) + "/" + file_spec.GetFilename();
-	} else {
-		fullpath = file_spec.GetFilename();
-	}
+std::string get_breakpoint_name(SBBreakpoint bp) {
+	if (!bp.IsValid()) return "???";
 
-	SBAddress addr = frame.GetPCAddress();
-	SBTarget target = frame.GetThread().GetProcess().GetTarget();
+	std::string name = "???";
+	if (bp.GetNumLocations() > 0) {
+		SBBreakpointLocation loc = bp.GetLocationAtIndex(0);
+		SBAddress addr = loc.GetAddress();
 
-	const std::vector<std::string>& lines = cache.get_lines(fullpath);
-	if (lines.empty() && !std::ifstream(fullpath).good()) {
-		draw_text(cx, cy, TB_RED | TB_BOLD, TB_DEFAULT, "Could not open source: " + fullpath);
+		SBFunction func = addr.GetFunction();
+		if (func.IsValid()) {
+			const char* n = func.GetName();
+			if (n) name = n;
+		} else {
+			SBSymbol sym = addr.GetSymbol();
+			if (sym.IsValid()) {
+				const char* n = sym.GetName();
+				if (n) name = n;
+			}
+		}
 
-		SBFunction func = frame.GetFunction();
-		std::string func_name = func.IsValid() ? func.GetName() : "???";
+		SBLineEntry line_entry = addr.GetLineEntry();
+		if (line_entry.IsValid()) {
+			std::string file_name;
+			SBFileSpec fs = line_entry.GetFileSpec();
+			if (fs.IsValid()) file_name = fs.GetFilename();
 
-		char addr_buf[64];
-		snprintf(addr_buf, sizeof(addr_buf), "At address: 0x%lx", (unsigned long)addr.GetLoadAddress(target));
+			if (name == "???") {
+				if (!file_name.empty()) name = file_name + ":" + std::to_string(line_entry.GetLine());
+			} else {
+				if (!file_name.empty()) name += " (" + file_name + ":" + std::to_string(line_entry.GetLine()) + ")";
+			}
+		}
+	}
+	return name;
+}
 
-		draw_text(cx, cy + 2, TB_WHITE, TB_DEFAULT, "Function: " + func_name);
-		draw_text(cx, cy + 3, TB_WHITE, TB_DEFAULT, addr_buf);
-		draw_text(cx, cy + 5, TB_YELLOW, TB_DEFAULT, "Press 'n' (Step Over) or 'o' (Step Out) to return to your code.");
+std::string get_full_path(const SBFileSpec& fs) {
+	if (fs.GetDirectory()) {
+		return std::string(fs.GetDirectory()) + "/" + fs.GetFilename();
+	}
+	return fs.GetFilename() ? fs.GetFilename() : "";
+}
 
-		// Disassembly fallback
-		SBInstructionList instructions = target.ReadInstructions(addr, (uint32_t)(ch - 8));
-		if (instructions.IsValid()) {
-			for (uint32_t i = 0; i < instructions.GetSize() && (int)i < ch - 8; ++i) {
-				SBInstruction insn = instructions.GetInstructionAtIndex(i);
-				std::string dis = insn.GetMnemonic(target);
-				dis += " ";
-				dis += insn.GetOperands(target);
+// Breakpoint lines per source file as a bitmap indexed by line number. It is
+// rebuilt lazily after LLDB reports a breakpoint change, so drawing the
+// gutter only costs a lookup per visible line.
+struct BreakpointIndex {
+	bool dirty = true;
+	std::unordered_map<std::string, std::vector<bool>> lines_by_file;
 
-				uint16_t fg = (insn.GetAddress() == addr) ? TB_WHITE | TB_BOLD : TB_DEFAULT;
-				uint16_t bg = (insn.GetAddress() == addr) ? TB_BLUE : TB_DEFAULT;
+	void invalidate() { dirty = true; }
 
-				char insn_addr_buf[32];
-				snprintf(insn_addr_buf, sizeof(insn_addr_buf), "0x%lx: ", (unsigned long)insn.GetAddress().GetLoadAddress(target));
+	const std::vector<bool>* lines_for(SBTarget& target, const std::string& fullpath) {
+		if (dirty) rebuild(target);
+		auto it = lines_by_file.find(fullpath);
+		return it == lines_by_file.end() ? nullptr : &it->second;
+	}
 
-				draw_text(cx, cy + 7 + i, fg, bg, std::string(insn_addr_buf) + dis);
+	void rebuild(SBTarget& target) {
+		LLDBTimer timer(LLDB_BREAKPOINTS);
+		dirty = false;
+		lines_by_file.clear();
+
+		uint32_t num_breakpoints = target.GetNumBreakpoints();
+		for (uint32_t i = 0; i < num_breakpoints; ++i) {
+			SBBreakpoint bp = target.GetBreakpointAtIndex(i);
+			uint32_t num_locs = bp.GetNumLocations();
+			for (uint32_t j = 0; j < num_locs; ++j) {
+				SBLineEntry le = bp.GetLocationAtIndex(j).GetAddress().GetLineEntry();
+				if (!le.IsValid() || !le.GetFileSpec().IsValid()) continue;
+
+				std::vector<bool>& lines = lines_by_file[get_full_path(le.GetFileSpec())];
+				uint32_t line = le.GetLine();
+				if (line >= lines.size()) lines.resize(line + 1, false);
+				lines[line] = true;
 			}
 		}
-		return;
 	}
+};
 
-	// Get breakpoints for this file
-	std::vector<uint32_t> bp_lines;
-	uint32_t num_breakpoints = target.GetNumBreakpoints();
-	for (uint32_t i = 0; i < num_breakpoints; ++i) {
-		SBBreakpoint bp = target.GetBreakpointAtIndex(i);
-		uint32_t num_locs = bp.GetNumLocations();
-		for (uint32_t j = 0; j < num_locs; ++j) {
-			SBBreakpointLocation loc = bp.GetLocationAtIndex(j);
-			SBLineEntry le = loc.GetAddress().GetLineEntry();
-			if (le.IsValid()) {
-				SBFileSpec fs = le.GetFileSpec();
-				if (fs.IsValid()) {
-					std::string bp_path;
-					if (fs.GetDirectory()) {
-						bp_path = std::string(fs.GetDirectory()) + "/" + fs.GetFilename();
-					} else {
-						bp_path = fs.GetFilename();
-					}
-					if (bp_path == fullpath) {
-						bp_lines.push_back(le.GetLine());
+struct DisasmRow {
+	addr_t addr = 0;
+	bool is_source = false;
+	std::string text;
+};
+
+// One decoded function (or symbol) with its source lines interleaved. Blocks
+// without symbol information are a fixed window of instructions instead.
+struct DisasmBlock {
+	addr_t start = 0;
+	addr_t end = 0;
+	bool exact = false;
+	std::vector<DisasmRow> rows;
+};
+
+std::string expand_tabs(std::string_view text) {
+	std::string out;
+	for (char c : text) {
+		if (c == '\t') out += "    ";
+		else if (c != '\r' && c != '\n') out += c;
+	}
+	return out;
+}
+
+// Decoded and formatted instructions keyed by the start of their range, so a
+// redraw or a scroll never goes back to LLDB for code it has already seen.
+// Load addresses are only valid for one process, a new pid drops everything.
+struct DisasmCache {
+	static const size_t MAX_BLOCKS = 64;
+	static const uint32_t WINDOW = 64;
+
+	uint64_t pid = 0;
+	uint64_t generation = 0;
+	std::unordered_map<addr_t, DisasmBlock> blocks;
+
+	void check_process(SBTarget& target) {
+		uint64_t cur = target.GetProcess().GetProcessID();
+		if (cur != pid || blocks.size() >= MAX_BLOCKS) {
+			pid = cur;
+			blocks.clear();
+			generation++;
+		}
+	}
+
+	// Function and symbol blocks win over raw windows covering the same code
+	DisasmBlock* find(addr_t addr) {
+		DisasmBlock* window = nullptr;
+		for (auto& entry : blocks) {
+			DisasmBlock& b = entry.second;
+			if (addr < b.start || addr >= b.end) continue;
+			if (b.exact) return &b;
+			window = &b;
+		}
+		return window;
+	}
+
+	DisasmBlock* block_at(SBTarget& target, addr_t addr, SourceCache& sources) {
+		check_process(target);
+		DisasmBlock* window = find(addr);
+		if (window && window->exact) return window;
+
+		SBAddress so_addr = target.ResolveLoadAddress(addr);
+		if (!so_addr.IsValid()) return nullptr;
+
+		DisasmBlock block;
+		SBInstructionList instructions;
+		{
+			LLDBTimer timer(LLDB_READ_INSTRUCTIONS);
+			SBFunction func = so_addr.GetFunction();
+			SBSymbol sym = so_addr.GetSymbol();
+			if (func.IsValid()) {
+				block.start = func.GetStartAddress().GetLoadAddress(target);
+				block.end = func.GetEndAddress().GetLoadAddress(target);
+				instructions = func.GetInstructions(target);
+				block.exact = true;
+			} else if (sym.IsValid()) {
+				block.start = sym.GetStartAddress().GetLoadAddress(target);
+				block.end = sym.GetEndAddress().GetLoadAddress(target);
+				instructions = sym.GetInstructions(target);
+				block.exact = true;
+			}
+			if (!block.exact || addr < block.start || addr >= block.end || !instructions.IsValid() || instructions.GetSize() == 0) {
+				// No function around addr after all, the cached window will do
+				if (window) return window;
+				block = DisasmBlock();
+				block.start = addr;
+				instructions = target.ReadInstructions(so_addr, WINDOW);
+			}
+		}
+		if (!instructions.IsValid() || instructions.GetSize() == 0) return nullptr;
+
+		// A raw window stops where known code starts, so it never overlaps it
+		addr_t limit = UINT64_MAX;
+		if (!block.exact) {
+			for (auto& entry : blocks) {
+				if (entry.second.exact && entry.second.start > addr) limit = std::min(limit, entry.second.start);
+			}
+		}
+
+		std::string last_path;
+		uint32_t last_line = 0;
+		for (uint32_t i = 0; i < instructions.GetSize(); ++i) {
+			SBInstruction insn = instructions.GetInstructionAtIndex(i);
+			SBAddress insn_addr = insn.GetAddress();
+			addr_t load = insn_addr.GetLoadAddress(target);
+			if (load >= limit) break;
+
+			// A source row whenever the line changes, optimized code jumps around
+			SBLineEntry line_entry = insn_addr.GetLineEntry();
+			if (line_entry.IsValid() && line_entry.GetLine() > 0) {
+				std::string path = get_full_path(line_entry.GetFileSpec());
+				uint32_t line = line_entry.GetLine();
+				if (line != last_line || path != last_path) {
+					last_path = path;
+					last_line = line;
+					SourceFile& source = sources.get(path);
+					DisasmRow row;
+					row.is_source = true;
+					const char* filename = line_entry.GetFileSpec().GetFilename();
+					row.text = std::string(filename ? filename : "") + ":" + std::to_string(line);
+					if (!source.missing && line <= source.line_count()) {
+						row.text += "  " + expand_tabs(source.line(line - 1));
 					}
+					block.rows.push_back(std::move(row));
 				}
 			}
+
+			const char* mnemonic = insn.GetMnemonic(target);
+			const char* operands = insn.GetOperands(target);
+			const char* comment = insn.GetComment(target);
+			char buf[64];
+			snprintf(buf, sizeof(buf), "  0x%lx <+%lu>: ", (unsigned long)load, (unsigned long)(load - block.start));
+
+			DisasmRow row;
+			row.addr = load;
+			row.text = std::string(buf) + (mnemonic ? mnemonic : "") + " " + (operands ? operands : "");
+			if (comment && *comment) row.text += "  ; " + std::string(comment);
+			block.rows.push_back(std::move(row));
+
+			if (!block.exact) block.end = load + insn.GetByteSize();
+		}
+
+		if (block.rows.empty()) return nullptr;
+
+		// Raw windows that turn out to overlap a function make way for it
+		if (block.exact) {
+			for (auto it = blocks.begin(); it != blocks.end();) {
+				bool overlaps = !it->second.exact && it->second.start < block.end && it->second.end > block.start;
+				it = overlaps ? blocks.erase(it) : std::next(it);
+			}
+		}
+
+		addr_t start = block.start;
+		return &(blocks[start] = std::move(block));
+	}
+
+	// The function or symbol ending right before addr. Nothing is decoded when
+	// the bytes before it belong to neither, like alignment padding, since a
+	// window started there would likely be misaligned.
+	DisasmBlock* block_before(SBTarget& target, addr_t addr, SourceCache& sources) {
+		if (addr == 0) return nullptr;
+		SBAddress so_addr = target.ResolveLoadAddress(addr - 1);
+		if (!so_addr.IsValid()) return nullptr;
+
+		addr_t start = LLDB_INVALID_ADDRESS;
+		SBFunction func = so_addr.GetFunction();
+		SBSymbol sym = so_addr.GetSymbol();
+		if (func.IsValid()) start = func.GetStartAddress().GetLoadAddress(target);
+		else if (sym.IsValid()) start = sym.GetStartAddress().GetLoadAddress(target);
+		if (start == LLDB_INVALID_ADDRESS || start >= addr) return nullptr;
+
+		DisasmBlock* b = block_at(target, start, sources);
+		return b && b->exact ? b : nullptr;
+	}
+};
+
+// The blocks currently laid out in the disassembly pane. Scrolling past
+// either edge pulls in the neighbouring block, so the code around the PC can
+// be browsed in both directions.
+struct DisasmView {
+	static const int MAX_GROW = 8;
+
+	std::vector<addr_t> starts;
+	uint64_t generation = 0;
+	addr_t pc = 0;
+	int scroll = 0;
+
+	DisasmBlock* block(DisasmCache& cache, size_t i) {
+		auto it = cache.blocks.find(starts[i]);
+		return it == cache.blocks.end() ? nullptr : &it->second;
+	}
+
+	int row_count(DisasmCache& cache) {
+		int total = 0;
+		for (size_t i = 0; i < starts.size(); ++i) {
+			DisasmBlock* b = block(cache, i);
+			if (b) total += (int)b->rows.size();
+		}
+		return total;
+	}
+
+	const DisasmRow* row(DisasmCache& cache, int idx) {
+		for (size_t i = 0; i < starts.size(); ++i) {
+			DisasmBlock* b = block(cache, i);
+			if (!b) continue;
+			if (idx < (int)b->rows.size()) return &b->rows[idx];
+			idx -= (int)b->rows.size();
+		}
+		return nullptr;
+	}
+
+	// Centers the view on the PC, called when the PC moved
+	void focus(SBTarget& target, DisasmCache& cache, SourceCache& sources, addr_t new_pc, int height) {
+		pc = new_pc;
+		starts.clear();
+		scroll = 0;
+		DisasmBlock* b = cache.block_at(target, pc, sources);
+		generation = cache.generation;
+		if (!b) return;
+		starts.push_back(b->start);
+		for (int i = 0; i < (int)b->rows.size(); ++i) {
+			if (b->rows[i].addr == pc) {
+				scroll = i - height / 2;
+				break;
+			}
+		}
+	}
+
+	// Loads neighbouring blocks until the rows on screen exist, then clamps
+	void fill(SBTarget& target, DisasmCache& cache, SourceCache& sources, int height) {
+		for (int grow = 0; scroll < 0 && grow < MAX_GROW && !starts.empty(); ++grow) {
+			DisasmBlock* first = block(cache, 0);
+			if (!first || !first->exact || first->start == 0) break;
+			addr_t first_start = first->start;
+			DisasmBlock* prev = cache.block_before(target, first_start, sources);
+			if (!prev || !prev->exact || prev->end > first_start || generation != cache.generation) break;
+			starts.insert(starts.begin(), prev->start);
+			scroll += (int)prev->rows.size();
+		}
+		scroll = std::max(0, scroll);
+
+		for (int grow = 0; scroll + height > row_count(cache) && grow < MAX_GROW && !starts.empty(); ++grow) {
+			DisasmBlock* last = block(cache, starts.size() - 1);
+			if (!last) break;
+			addr_t last_end = last->end;
+			DisasmBlock* next = cache.block_at(target, last_end, sources);
+			if (!next || next->start < last_end || generation != cache.generation) break;
+			starts.push_back(next->start);
+		}
+		scroll = std::min(scroll, std::max(0, row_count(cache) - height));
+	}
+};
+
+struct MemoryPage {
+	std::vector<uint8_t> data;
+	size_t readable = 0;
+};
+
+// Target memory in page sized chunks, read on first use and kept for the
+// current stop. Pages seen at earlier stops are kept in previous so the
+// bytes that changed since then can be highlighted.
+struct MemoryCache {
+	static const addr_t PAGE_SIZE = 4096;
+	static const size_t MAX_PREVIOUS = 256;
+
+	uint64_t pid = 0;
+	uint32_t stop_id = UINT32_MAX;
+	std::unordered_map<addr_t, MemoryPage> pages;
+	std::unordered_map<addr_t, MemoryPage> previous;
+
+	void sync(SBProcess& process) {
+		uint64_t cur_pid = process.GetProcessID();
+		uint32_t cur_stop = process.GetStopID();
+		if (cur_pid == pid && cur_stop == stop_id) return;
+
+		if (cur_pid != pid || previous.size() + pages.size() > MAX_PREVIOUS) previous.clear();
+		if (cur_pid == pid) {
+			for (auto& entry : pages) previous[entry.first] = std::move(entry.second);
+		}
+		pages.clear();
+		pid = cur_pid;
+		stop_id = cur_stop;
+	}
+
+	const MemoryPage& page(SBProcess& process, addr_t page_addr) {
+		auto it = pages.find(page_addr);
+		if (it != pages.end()) return it->second;
+
+		MemoryPage& page = pages[page_addr];
+		page.data.resize(PAGE_SIZE);
+		SBError error;
+		LLDBTimer timer(LLDB_READ_MEMORY);
+		page.readable = process.ReadMemory(page_addr, page.data.data(), PAGE_SIZE, error);
+		return page;
+	}
+
+	// The byte at addr or -1 when it cannot be read
+	int byte(SBProcess& process, addr_t addr, bool& changed) {
+		addr_t page_addr = addr & ~(PAGE_SIZE - 1);
+		size_t offset = addr - page_addr;
+		const MemoryPage& cur = page(process, page_addr);
+		changed = false;
+		if (offset >= cur.readable) return -1;
+
+		auto prev = previous.find(page_addr);
+		if (prev != previous.end() && offset < prev->second.readable) {
+			changed = prev->second.data[offset] != cur.data[offset];
+		}
+		return cur.data[offset];
+	}
+};
+
+struct MemoryView {
+	addr_t base = 0;
+	int scroll = 0;
+	std::string label;
+
+	void open(addr_t addr, const std::string& name) {
+		base = addr;
+		scroll = 0;
+		label = name;
+	}
+};
+
+// Where a value's bytes live: the pointee for pointers, the object itself
+// for everything else that is in memory
+bool memory_address_of(SBValue value, addr_t& addr) {
+	if (!value.IsValid()) return false;
+	if (value.GetType().IsPointerType()) {
+		addr = value.GetValueAsUnsigned(0);
+		return addr != 0;
+	}
+	addr = value.GetLoadAddress();
+	return addr != LLDB_INVALID_ADDRESS;
+}
+
+void draw_memory_view(SBProcess& process, bool stopped, int x, int y, int w, int h, MemoryCache& cache, MemoryView& view) {
+	draw_box(x, y, w, h, "Memory: " + view.label + " (m to close)");
+	int cx = x + 1;
+	int cy = y + 1;
+	int ch = h - 2;
+	int cw = w - 2;
+
+	if (!stopped) {
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, "Process not stopped.");
+		return;
+	}
+
+	cache.sync(process);
+	// Address (20 columns), 3 columns per hex byte, a gap and 1 per ASCII byte
+	int bytes_per_row = 16;
+	while (bytes_per_row > 1 && 20 + bytes_per_row * 4 + 1 > cw) bytes_per_row /= 2;
+	for (int i = 0; i < ch; ++i) {
+		int64_t offset = (int64_t)(view.scroll + i) * bytes_per_row;
+		if (offset < 0 && (addr_t)(-offset) > view.base) continue;
+		addr_t row_addr = view.base + offset;
+
+		char buf[32];
+		snprintf(buf, sizeof(buf), "0x%016lx  ", (unsigned long)row_addr);
+		std::string addr_text = buf;
+		if ((int)addr_text.length() > cw) addr_text = addr_text.substr(0, std::max(0, cw));
+		draw_text(cx, cy + i, TB_DEFAULT, TB_DEFAULT, addr_text);
+
+		int hex_x = cx + 20;
+		int ascii_x = hex_x + bytes_per_row * 3 + 1;
+		for (int b = 0; b < bytes_per_row; ++b) {
+			bool changed = false;
+			int value = cache.byte(process, row_addr + b, changed);
+			uint16_t fg = changed ? TB_RED | TB_BOLD : TB_DEFAULT;
+			char hex[4];
+			if (value < 0) {
+				snprintf(hex, sizeof(hex), "??");
+			} else {
+				snprintf(hex, sizeof(hex), "%02x", value);
+			}
+			if (hex_x + b * 3 < cx + cw) tb_set_cell(hex_x + b * 3, cy + i, hex[0], fg, TB_DEFAULT);
+			if (hex_x + b * 3 + 1 < cx + cw) tb_set_cell(hex_x + b * 3 + 1, cy + i, hex[1], fg, TB_DEFAULT);
+			char c = (value >= 0x20 && value < 0x7f) ? (char)value : '.';
+			if (ascii_x + b < cx + cw) tb_set_cell(ascii_x + b, cy + i, c, fg, TB_DEFAULT);
 		}
 	}
+}
+
+bool has_source(SBFrame& frame, SourceCache& cache) {
+	SBLineEntry line_entry = frame.GetLineEntry();
+	if (!line_entry.IsValid() || !line_entry.GetFileSpec().IsValid()) return false;
+	return !cache.get(get_full_path(line_entry.GetFileSpec())).missing;
+}
+
+void draw_disassembly_view(SBFrame& frame, int x, int y, int w, int h, const std::string& title, DisasmCache& cache, DisasmView& view, SourceCache& sources) {
+	draw_box(x, y, w, h, title);
+	int cx = x + 1;
+	int cy = y + 1;
+	int ch = h - 2;
+	int cw = w - 2;
+
+	if (!frame.IsValid()) {
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No frame selected.");
+		return;
+	}
+
+	SBTarget target = frame.GetThread().GetProcess().GetTarget();
+	addr_t pc = frame.GetPC();
+	if (pc != view.pc || view.generation != cache.generation || view.starts.empty()) {
+		view.focus(target, cache, sources, pc, ch);
+	}
+	view.fill(target, cache, sources, ch);
+	// Growing may have overflowed the cache, which drops the blocks in view
+	if (view.generation != cache.generation) {
+		view.focus(target, cache, sources, pc, ch);
+		view.fill(target, cache, sources, ch);
+	}
+
+	if (view.starts.empty()) {
+		char buf[64];
+		snprintf(buf, sizeof(buf), "No instructions at 0x%lx", (unsigned long)pc);
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, buf);
+		return;
+	}
+
+	for (int i = 0; i < ch; ++i) {
+		const DisasmRow* row = view.row(cache, view.scroll + i);
+		if (!row) break;
+
+		bool is_pc = !row->is_source && row->addr == pc;
+		uint16_t fg = row->is_source ? TB_YELLOW : (is_pc ? TB_WHITE | TB_BOLD : TB_DEFAULT);
+		uint16_t bg = is_pc ? TB_BLUE : TB_DEFAULT;
+		std::string text = row->text;
+		if ((int)text.length() > cw) text = text.substr(0, cw);
+		if (is_pc) {
+			for (int k = 0; k < cw; ++k) tb_set_cell(cx + k, cy + i, ' ', fg, bg);
+		}
+		draw_text(cx, cy + i, fg, bg, text);
+	}
+}
+
+void draw_source_view(SBFrame &frame, int x, int y, int w, int h, SourceCache& cache, BreakpointIndex& bp_index, int scroll_offset, int cursor_line) {
+	draw_box(x, y, w, h, "Source");
+
+	int cx = x + 1;
+	int cy = y + 1;
+	int ch = h - 2;
+	int cw = w - 2;
+
+	if (!frame.IsValid()) {
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No frame selected.");
+		return;
+	}
+
+	SBLineEntry line_entry = frame.GetLineEntry();
+	if (!line_entry.IsValid()) {
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No line entry info.");
+		return;
+	}
+
+	SBFileSpec file_spec = line_entry.GetFileSpec();
+	if (!file_spec.IsValid()) return;
 
-	int total_lines = (int)lines.size();
+	std::string fullpath = get_full_path(file_spec);
+
+	SBTarget target = frame.GetThread().GetProcess().GetTarget();
+
+	// Frames without source are drawn by draw_disassembly_view instead
+	SourceFile& source = cache.get(fullpath);
+	if (source.missing) {
+		draw_text(cx, cy, TB_RED | TB_BOLD, TB_DEFAULT, "Could not open source: " + fullpath);
+		return;
+	}
+
+	const std::vector<bool>* bp_lines = bp_index.lines_for(target, fullpath);
+
+	int total_lines = (int)source.line_count();
 	int current_line = line_entry.GetLine();
+	// A watchpoint stop points at the line that touched the memory
+	bool watch_hit = frame.GetFrameID() == 0 && frame.GetThread().GetStopReason() == eStopReasonWatchpoint;
+	uint16_t current_bg = watch_hit ? TB_MAGENTA : TB_BLUE;
 	for (int i = 0; i < ch; ++i) {
 		int line_idx = scroll_offset + i + 1;
 		if (line_idx > total_lines) break;
 
-		std::string src = lines[line_idx - 1];
-		// Handle basic tab expansion (simple version)
-		std::string expanded;
-		for (char c : src) {
-			if (c == '\t') expanded += "    ";
-			else expanded += c;
-		}
-		src = expanded;
-
 		bool is_current = (line_idx == current_line);
-		bool has_breakpoint = std::find(bp_lines.begin(), bp_lines.end(), (uint32_t)line_idx) != bp_lines.end();
+		bool has_breakpoint = bp_lines && line_idx < (int)bp_lines->size() && (*bp_lines)[line_idx];
 
-		char buf[32];
-		snprintf(buf, sizeof(buf), "%4d ", line_idx);
-		std::string num_str(buf);
+		char num_str[32];
+		int num_len = snprintf(num_str, sizeof(num_str), "%4d ", line_idx);
 
-		uint16_t bg = is_current ? TB_BLUE : TB_DEFAULT;
+		uint16_t bg = is_current ? current_bg : TB_DEFAULT;
 		uint16_t fg = is_current ? TB_WHITE | TB_BOLD : TB_DEFAULT;
 
 		// Draw breakpoint indicator
@@ -451,16 +1951,21 @@ void draw_source_view(SBFrame &frame, int x, int y, int w, int h, SourceCache& c
 			tb_set_cell(cx, cy + i, ' ', fg, bg);
 		}
 
-		draw_text(cx + 1, cy + i, fg, bg, num_str);
+		// The cursor line, set by clicking, is the target of run to cursor
+		uint16_t num_fg = (line_idx == cursor_line) ? fg | TB_REVERSE : fg;
+		for (int k = 0; k < num_len; ++k) {
+			tb_set_cell(cx + 1 + k, cy + i, num_str[k], num_fg, bg);
+		}
 
-		int src_max_len = cw - (int)num_str.length() - 1;
-		if ((int)src.length() > src_max_len) {
-			src = src.substr(0, src_max_len);
+		int src_x = cx + 1 + num_len;
+		for (const DisplayCell& cell : source.display_line(line_idx - 1)) {
+			if (src_x + cell.width > cx + cw) break;
+			tb_set_cell(src_x, cy + i, cell.ch, fg, bg);
+			src_x += cell.width;
 		}
-		draw_text(cx + 1 + num_str.length(), cy + i, fg, bg, src);
 
 		if (is_current) {
-			for (int k = cx + 1 + num_str.length() + src.length(); k < cx + cw; ++k) {
+			for (int k = src_x; k < cx + cw; ++k) {
 				tb_set_cell(k, cy + i, ' ', fg, bg);
 			}
 		}
@@ -485,6 +1990,121 @@ void draw_source_view(SBFrame &frame, int x, int y, int w, int h, SourceCache& c
 	}
 }
 
+struct LogpointBuffer;
+
+struct Logpoint {
+	LogpointBuffer* buffer;
+	break_id_t id;
+	std::vector<std::string> expressions;
+};
+
+struct LogpointSample {
+	std::time_t time = 0;
+	std::string text;
+};
+
+// Samples captured by logpoint callbacks. SetCallback registers an async
+// callback, which runs when the stop event is taken off the listener, here on
+// the EventPump thread. Slots are preallocated and only written under the lock.
+// The main loop drains them into the log at most every DRAIN_MS.
+struct LogpointBuffer {
+	static const int CAPACITY = 4096;
+	static const int DRAIN_MS = 100;
+
+	std::mutex mutex;
+	std::vector<LogpointSample> samples = std::vector<LogpointSample>(CAPACITY);
+	size_t head = 0;
+	size_t count = 0;
+	uint64_t dropped = 0;
+	std::list<Logpoint> entries;
+	std::chrono::steady_clock::time_point last_drain;
+
+	bool empty() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return entries.empty();
+	}
+
+	// Registers the callback, the list keeps the baton address stable
+	void attach(SBBreakpoint& bp, const std::vector<std::string>& expressions) {
+		Logpoint* logpoint;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			entries.push_back({this, bp.GetID(), expressions});
+			logpoint = &entries.back();
+		}
+		bp.SetAutoContinue(true);
+		bp.SetCallback(on_hit, logpoint);
+	}
+
+	std::string expressions_for(break_id_t id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const Logpoint& logpoint : entries) {
+			if (logpoint.id != id) continue;
+			std::string joined;
+			for (const std::string& expr : logpoint.expressions) {
+				if (!joined.empty()) joined += ", ";
+				joined += expr;
+			}
+			return joined;
+		}
+		return "";
+	}
+
+	// Moves the captured samples into the log, returns how many there were
+	size_t drain(LogBuffer& log_buffer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		last_drain = std::chrono::steady_clock::now();
+		size_t drained = count;
+		if (dropped > 0) {
+			log_msg(log_buffer, "Logpoints: " + std::to_string(dropped) + " sample(s) dropped");
+			dropped = 0;
+		}
+		for (; count > 0; --count) {
+			LogpointSample& sample = samples[head];
+			log_buffer.push(sample.text, sample.time);
+			head = (head + 1) % CAPACITY;
+		}
+		return drained;
+	}
+
+	bool drain_due() const {
+		return elapsed_ms(last_drain) >= DRAIN_MS;
+	}
+
+private:
+	static bool on_hit(void* baton, SBProcess& /*process*/, SBThread& thread, SBBreakpointLocation& /*location*/) {
+		Logpoint* logpoint = static_cast<Logpoint*>(baton);
+		SBFrame frame = thread.GetFrameAtIndex(0);
+
+		std::string text = "[" + std::to_string(logpoint->id) + "]";
+		for (size_t i = 0; i < logpoint->expressions.size(); ++i) {
+			const std::string& expr = logpoint->expressions[i];
+			SBValue val = is_variable_path(expr) ? frame.GetValueForVariablePath(expr.c_str()) : SBValue();
+			if (!val.IsValid() || val.GetError().Fail()) val = frame.EvaluateExpression(expr.c_str());
+			text += (i == 0 ? " " : ", ") + expr + " = ";
+			text += val.IsValid() && !val.GetError().Fail() ? format_value(val) : "<error>";
+		}
+		logpoint->buffer->capture(text);
+		// Not stopping lets LLDB resume the process right away
+		return false;
+	}
+
+	void capture(const std::string& text) {
+		std::lock_guard<std::mutex> lock(mutex);
+		LogpointSample* slot;
+		if (count < CAPACITY) {
+			slot = &samples[(head + count) % CAPACITY];
+			count++;
+		} else {
+			slot = &samples[head];
+			head = (head + 1) % CAPACITY;
+			dropped++;
+		}
+		slot->time = std::time(nullptr);
+		slot->text.assign(text);
+	}
+} logpoints;
+
 void draw_breakpoints_view(SBTarget& target, int x, int y, int w, int h) {
 	draw_box(x, y, w, h, "Breakpoints");
 	int cx = x + 1;
@@ -493,70 +2113,226 @@ void draw_breakpoints_view(SBTarget& target, int x, int y, int w, int h) {
 
 	if (!target.IsValid()) return;
 
+	LLDBTimer timer(LLDB_BREAKPOINTS);
 	int num_bps = target.GetNumBreakpoints();
 	for (int i = 0; i < num_bps && i < mh; ++i) {
 		SBBreakpoint bp = target.GetBreakpointAtIndex(i);
 		std::string name = get_breakpoint_name(bp);
 
+		uint32_t hits = bp.GetHitCount();
 		char buf[128];
-		snprintf(buf, sizeof(buf), "%d: %s", bp.GetID(), name.c_str());
+		snprintf(buf, sizeof(buf), "%d: %s (%u hit%s)", bp.GetID(), name.c_str(), hits, hits == 1 ? "" : "s");
 		std::string line = buf;
+		if (bp.GetIgnoreCount() > 0) line += " ignore=" + std::to_string(bp.GetIgnoreCount());
+		const char* condition = bp.GetCondition();
+		if (condition && *condition) line += " if " + std::string(condition);
+		std::string logged = logpoints.expressions_for(bp.GetID());
+		if (!logged.empty()) line += " log " + logged;
+		if ((int)line.length() > w - 2) line = line.substr(0, w - 2);
 		draw_text(cx, cy + i, TB_DEFAULT, TB_DEFAULT, line);
 	}
 }
 
-void draw_watch_view(SBFrame& frame, int x, int y, int w, int h, const std::vector<std::string>& expressions, int scroll_offset) {
-	draw_box(x, y, w, h, "Watch");
+void draw_watch_view(SBFrame& frame, int x, int y, int w, int h, const std::string& title, const std::vector<WatchExpression>& expressions, WatchSnapshot& snapshot, LogBuffer& log_buffer, int scroll_offset) {
+	draw_box(x, y, w, h, title);
+
+	if (expressions.empty()) {
+		draw_text(x + 1, y + 1, TB_DEFAULT, TB_DEFAULT, "No watch expressions.");
+		return;
+	}
+
+	if (!frame.IsValid()) {
+		draw_text(x + 1, y + 1, TB_RED, TB_DEFAULT, "No frame selected.");
+		return;
+	}
+
+	draw_var_tree(snapshot.get_tree(frame, expressions, log_buffer), x, y, w, h, scroll_offset);
+}
+
+// Backtrace rows of one thread at one stop. GetNumFrames would unwind the
+// whole stack, so frames are only fetched (and symbolicated) for the rows
+// that are drawn and the end of the stack is found by probing.
+struct StackSnapshot {
+	StopKey key;
+	std::unordered_map<uint32_t, std::string> rows;
+	uint32_t end = UINT32_MAX;
+
+	void sync(SBThread& thread) {
+		SBFrame top = thread.GetFrameAtIndex(0);
+		StopKey cur = StopKey::from_frame(top);
+		if (cur != key) {
+			key = cur;
+			rows.clear();
+			end = UINT32_MAX;
+		}
+	}
+
+	bool has_frame(SBThread& thread, uint32_t idx) {
+		if (idx >= end) return false;
+		if (rows.count(idx)) return true;
+		return !row(thread, idx).empty();
+	}
+
+	const std::string& row(SBThread& thread, uint32_t idx) {
+		auto it = rows.find(idx);
+		if (it != rows.end()) return it->second;
+
+		SBFrame frame;
+		{
+			LLDBTimer timer(LLDB_FRAME_AT_INDEX);
+			frame = thread.GetFrameAtIndex(idx);
+		}
+		std::string& text = rows[idx];
+		if (!frame.IsValid()) {
+			end = std::min(end, idx);
+			return text;
+		}
+
+		const char* name = frame.GetDisplayFunctionName();
+		text = "#" + std::to_string(idx) + " " + (name ? name : "???");
+		SBLineEntry line_entry = frame.GetLineEntry();
+		if (line_entry.IsValid() && line_entry.GetFileSpec().GetFilename()) {
+			text += " at " + std::string(line_entry.GetFileSpec().GetFilename()) + ":" + std::to_string(line_entry.GetLine());
+		} else {
+			char addr_buf[32];
+			snprintf(addr_buf, sizeof(addr_buf), " 0x%lx", (unsigned long)frame.GetPC());
+			text += addr_buf;
+			SBModule module = frame.GetModule();
+			if (module.IsValid() && module.GetFileSpec().GetFilename()) {
+				text += " in " + std::string(module.GetFileSpec().GetFilename());
+			}
+		}
+		return text;
+	}
+};
+
+void draw_stack_view(SBThread& thread, int x, int y, int w, int h, const std::string& title, StackSnapshot& snapshot, int scroll_offset) {
+	draw_box(x, y, w, h, title);
 	int cx = x + 1;
 	int cy = y + 1;
 	int ch = h - 2;
 	int cw = w - 2;
 
-	if (expressions.empty()) {
-		draw_text(cx, cy, TB_DEFAULT, TB_DEFAULT, "No watch expressions.");
+	if (!thread.IsValid()) {
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, "No thread selected.");
 		return;
 	}
 
-	std::vector<VarLine> lines;
-	for (const auto& expr : expressions) {
-		SBValue val = frame.EvaluateExpression(expr.c_str());
-		if (val.IsValid() && !val.GetError().Fail()) {
-			collect_variables_recursive(val, 0, lines, cw, expr);
-		} else {
-			VarLine vl;
-			vl.text = expr + " = (error)";
-			if (val.GetError().GetCString()) {
-				vl.text += ": " + std::string(val.GetError().GetCString());
-			}
-			if ((int)vl.text.length() > cw) vl.text = vl.text.substr(0, cw - 3) + "...";
-			vl.indent = 0;
-			vl.prefix_start = 0;
-			vl.prefix_end = 0;
-			lines.push_back(vl);
+	snapshot.sync(thread);
+	uint32_t selected = thread.GetSelectedFrame().GetFrameID();
+	for (int i = 0; i < ch; ++i) {
+		uint32_t idx = scroll_offset + i;
+		if (!snapshot.has_frame(thread, idx)) break;
+
+		std::string text = snapshot.row(thread, idx);
+		if ((int)text.length() > cw) text = text.substr(0, cw - 3) + "...";
+		bool is_selected = (idx == selected);
+		uint16_t fg = is_selected ? TB_WHITE | TB_BOLD : TB_DEFAULT;
+		uint16_t bg = is_selected ? TB_BLUE : TB_DEFAULT;
+		if (is_selected) {
+			for (int k = 0; k < cw; ++k) tb_set_cell(cx + k, cy + i, ' ', fg, bg);
 		}
+		draw_text(cx, cy + i, fg, bg, text);
 	}
 
-	int total_lines = (int)lines.size();
-	int display_count = std::min(total_lines, ch);
+	// The depth is unknown until the end was drawn, so only hint at more rows
+	if (snapshot.has_frame(thread, scroll_offset + ch)) {
+		tb_set_cell(x + w - 1, y + h - 2, 0x2193, TB_WHITE, TB_DEFAULT);
+	}
+	if (scroll_offset > 0) {
+		tb_set_cell(x + w - 1, cy, 0x2191, TB_WHITE, TB_DEFAULT);
+	}
+}
 
-	for (int i = 0; i < display_count; ++i) {
-		int line_idx = scroll_offset + i;
-		if (line_idx < 0 || line_idx >= total_lines) continue;
+struct ThreadRow {
+	tid_t tid = 0;
+	std::string text;
+	bool stopped = false;
+	bool stale = true;
+};
 
-		const VarLine& vl = lines[line_idx];
-		for (int j = 0; j < (int)vl.text.length() && j < cw; ++j) {
-			uint16_t fg = TB_DEFAULT;
-			if (j >= vl.prefix_start && j < vl.prefix_end) {
-				fg = TB_BLACK | TB_BOLD;
-			}
-			tb_set_cell(cx + j, cy + i, vl.text[j], fg, TB_DEFAULT);
+// Thread list of one stop. The ids are enumerated once per stop, the stop
+// reason and top function only for rows that get drawn. Thread events mark
+// single rows stale instead of throwing the whole list away.
+struct ThreadsSnapshot {
+	uint64_t pid = 0;
+	uint32_t stop_id = UINT32_MAX;
+	std::vector<ThreadRow> rows;
+
+	void sync(SBProcess& process) {
+		if (process.GetProcessID() == pid && process.GetStopID() == stop_id) return;
+		pid = process.GetProcessID();
+		stop_id = process.GetStopID();
+
+		LLDBTimer timer(LLDB_THREADS);
+		uint32_t num_threads = process.GetNumThreads();
+		rows.assign(num_threads, ThreadRow());
+		for (uint32_t i = 0; i < num_threads; ++i) {
+			rows[i].tid = process.GetThreadAtIndex(i).GetThreadID();
+		}
+	}
+
+	void invalidate(tid_t tid) {
+		for (ThreadRow& row : rows) {
+			if (row.tid == tid) row.stale = true;
 		}
 	}
 
+	const ThreadRow& row(SBProcess& process, size_t idx) {
+		ThreadRow& row = rows[idx];
+		if (!row.stale) return row;
+		row.stale = false;
+
+		LLDBTimer timer(LLDB_THREADS);
+		SBThread thread = process.GetThreadByID(row.tid);
+		StopReason reason = thread.GetStopReason();
+		row.stopped = reason != eStopReasonNone && reason != eStopReasonInvalid;
+
+		const char* name = thread.GetName();
+		const char* func = thread.GetFrameAtIndex(0).GetDisplayFunctionName();
+		row.text = "#" + std::to_string(thread.GetIndexID()) + " " + (name ? name : std::to_string(row.tid)) + " " + (func ? func : "???");
+		if (row.stopped) {
+			char desc[128] = {0};
+			thread.GetStopDescription(desc, sizeof(desc));
+			row.text += " (" + std::string(desc) + ")";
+		}
+		return row;
+	}
+};
+
+void draw_threads_view(SBProcess& process, bool stopped, int x, int y, int w, int h, const std::string& title, ThreadsSnapshot& snapshot, int scroll_offset) {
+	draw_box(x, y, w, h, title);
+	int cx = x + 1;
+	int cy = y + 1;
+	int ch = h - 2;
+	int cw = w - 2;
+
+	if (!stopped) {
+		draw_text(cx, cy, TB_RED, TB_DEFAULT, "Process not stopped.");
+		return;
+	}
+
+	snapshot.sync(process);
+	tid_t selected = process.GetSelectedThread().GetThreadID();
+	int total = (int)snapshot.rows.size();
+	for (int i = 0; i < ch && scroll_offset + i < total; ++i) {
+		const ThreadRow& row = snapshot.row(process, scroll_offset + i);
+		std::string text = row.text;
+		if ((int)text.length() > cw) text = text.substr(0, cw - 3) + "...";
+
+		bool is_selected = (row.tid == selected);
+		uint16_t fg = is_selected ? TB_WHITE | TB_BOLD : (row.stopped ? TB_YELLOW : TB_DEFAULT);
+		uint16_t bg = is_selected ? TB_BLUE : TB_DEFAULT;
+		if (is_selected) {
+			for (int k = 0; k < cw; ++k) tb_set_cell(cx + k, cy + i, ' ', fg, bg);
+		}
+		draw_text(cx, cy + i, fg, bg, text);
+	}
+
 	// Draw scrollbar
-	if (total_lines > ch) {
-		int thumb_height = std::max(1, (ch * ch) / total_lines);
-		int max_scroll = total_lines - ch;
+	if (total > ch) {
+		int thumb_height = std::max(1, (ch * ch) / total);
+		int max_scroll = total - ch;
 		double scroll_percent = (double)scroll_offset / (double)max_scroll;
 		int thumb_pos = (ch - thumb_height) * scroll_percent;
 
@@ -572,27 +2348,187 @@ void draw_watch_view(SBFrame& frame, int x, int y, int w, int h, const std::vect
 	}
 }
 
+void draw_watchpoints_view(SBTarget& target, int x, int y, int w, int h, const std::string& title) {
+	draw_box(x, y, w, h, title);
+	int cx = x + 1;
+	int cy = y + 1;
+	int mh = h - 2;
+
+	if (!target.IsValid()) return;
+
+	LLDBTimer timer(LLDB_BREAKPOINTS);
+	int num_wps = target.GetNumWatchpoints();
+	if (num_wps == 0) {
+		draw_text(cx, cy, TB_DEFAULT, TB_DEFAULT, "No watchpoints. Press 'W' to add one.");
+		return;
+	}
+
+	for (int i = 0; i < num_wps && i < mh; ++i) {
+		SBWatchpoint wp = target.GetWatchpointAtIndex(i);
+		const char* spec = wp.GetWatchSpec();
+		uint32_t hits = wp.GetHitCount();
+		std::string kind = std::string(wp.IsWatchingReads() ? "r" : "") + (wp.IsWatchingWrites() ? "w" : "");
+
+		char buf[128];
+		snprintf(buf, sizeof(buf), "%d: 0x%lx/%zu %s (%u hit%s) ", wp.GetID(), (unsigned long)wp.GetWatchAddress(), wp.GetWatchSize(), kind.c_str(), hits, hits == 1 ? "" : "s");
+		std::string line = buf;
+		if (spec && *spec) line += spec;
+		if ((int)line.length() > w - 2) line = line.substr(0, w - 2);
+		draw_text(cx, cy + i, wp.IsEnabled() ? TB_DEFAULT : TB_WHITE, TB_DEFAULT, line);
+	}
+}
+
+// "expression [r|w|rw] [size=N]", the expression can also be a raw address
+struct WatchpointSpec {
+	std::string expression;
+	bool read = false;
+	bool write = true;
+	size_t size = 0;
+};
+
+WatchpointSpec parse_watchpoint_spec(const std::string& input) {
+	WatchpointSpec spec;
+	std::string rest = input;
+	while (true) {
+		size_t end = rest.find_last_not_of(" \t");
+		if (end == std::string::npos) break;
+		rest.erase(end + 1);
+		size_t start = rest.find_last_of(" \t");
+		if (start == std::string::npos) break;
+		std::string option = rest.substr(start + 1);
+
+		if (option == "r" || option == "w" || option == "rw") {
+			spec.read = option.find('r') != std::string::npos;
+			spec.write = option.find('w') != std::string::npos;
+		} else if (option.compare(0, 5, "size=") == 0) {
+			spec.size = strtoul(option.c_str() + 5, nullptr, 0);
+		} else {
+			break;
+		}
+		rest.erase(start);
+	}
+	size_t begin = rest.find_first_not_of(" \t");
+	if (begin != std::string::npos) spec.expression = rest.substr(begin);
+	return spec;
+}
+
+SBWatchpoint create_watchpoint(SBTarget& target, SBFrame& frame, const std::string& input, SBError& error) {
+	WatchpointSpec spec = parse_watchpoint_spec(input);
+	if (spec.expression.empty()) {
+		error.SetErrorString("missing expression");
+		return SBWatchpoint();
+	}
+
+	if (isdigit((unsigned char)spec.expression[0])) {
+		addr_t addr = strtoull(spec.expression.c_str(), nullptr, 0);
+		return target.WatchAddress(addr, spec.size ? spec.size : 8, spec.read, spec.write, error);
+	}
+
+	if (!frame.IsValid()) {
+		error.SetErrorString("no stack frame to evaluate the expression in");
+		return SBWatchpoint();
+	}
+	bool used_path = false;
+	SBValue val = evaluate_expression(frame, WatchExpression(spec.expression), used_path);
+	if (!val.IsValid() || val.GetError().Fail()) {
+		error = val.GetError();
+		return SBWatchpoint();
+	}
+	if (spec.size > 0) {
+		return target.WatchAddress(val.GetLoadAddress(), spec.size, spec.read, spec.write, error);
+	}
+	return val.Watch(true, spec.read, spec.write, error);
+}
+
+SBBreakpoint create_breakpoint_at(SBTarget& target, const std::string& input) {
+	SBBreakpoint bp;
+	size_t colon_pos = input.rfind(':');
+
+	if (colon_pos != std::string::npos && colon_pos < input.length() - 1) {
+		std::string line_str = input.substr(colon_pos + 1);
+		bool is_number = !line_str.empty() && std::all_of(line_str.begin(), line_str.end(), ::isdigit);
+
+		if (is_number) {
+			std::string filename = input.substr(0, colon_pos);
+			uint32_t line_no = (uint32_t)std::stoi(line_str);
+			bp = target.BreakpointCreateByLocation(filename.c_str(), line_no);
+			if (bp.IsValid() && bp.GetNumLocations() > 0) return bp;
+		}
+	}
+
+	return target.BreakpointCreateByName(input.c_str());
+}
+
+// "location [ignore=N] [if condition] [ignore=N] [log expr, ...]",
+// e.g. "example.c:54 if i == 4000" or "example.c:54 log i, sum"
+struct BreakpointSpec {
+	std::string location;
+	std::string condition;
+	uint32_t ignore_count = 0;
+	std::vector<std::string> log_expressions;
+};
+
+BreakpointSpec parse_breakpoint_spec(const std::string& spec_input) {
+	BreakpointSpec spec;
+	std::string input = spec_input;
+	size_t log_pos = input.find(" log ");
+	if (log_pos != std::string::npos) {
+		std::stringstream exprs(input.substr(log_pos + 5));
+		std::string expr;
+		while (std::getline(exprs, expr, ',')) {
+			size_t first = expr.find_first_not_of(" \t");
+			if (first == std::string::npos) continue;
+			spec.log_expressions.push_back(expr.substr(first, expr.find_last_not_of(" \t") - first + 1));
+		}
+		input.erase(log_pos);
+	}
+
+	size_t begin = input.find_first_not_of(" \t");
+	if (begin == std::string::npos) return spec;
+	size_t end = input.find_first_of(" \t", begin);
+	spec.location = input.substr(begin, end - begin);
+
+	std::string rest = end == std::string::npos ? "" : input.substr(end);
+	while (true) {
+		size_t start = rest.find_first_not_of(" \t");
+		if (start == std::string::npos) break;
+		rest = rest.substr(start);
+
+		if (rest.compare(0, 7, "ignore=") == 0) {
+			size_t stop = rest.find_first_of(" \t");
+			spec.ignore_count = (uint32_t)strtoul(rest.substr(7, stop - 7).c_str(), nullptr, 10);
+			rest = stop == std::string::npos ? "" : rest.substr(stop);
+		} else if (rest.compare(0, 3, "if ") == 0) {
+			spec.condition = rest.substr(3);
+			size_t ignore_pos = spec.condition.rfind(" ignore=");
+			if (ignore_pos != std::string::npos && spec.condition.find_first_of(" \t", ignore_pos + 1) == std::string::npos) {
+				spec.ignore_count = (uint32_t)strtoul(spec.condition.c_str() + ignore_pos + 8, nullptr, 10);
+				spec.condition.erase(ignore_pos);
+			}
+			break;
+		} else {
+			break;
+		}
+	}
+	return spec;
+}
+
+// Condition and ignore count are evaluated by LLDB itself, so filtered hits
+// never reach the UI
 SBBreakpoint create_breakpoint(SBTarget& target, const std::string& input) {
-	SBBreakpoint bp;
-	size_t colon_pos = input.rfind(':');
-
-	if (colon_pos != std::string::npos && colon_pos < input.length() - 1) {
-		std::string line_str = input.substr(colon_pos + 1);
-		bool is_number = !line_str.empty() && std::all_of(line_str.begin(), line_str.end(), ::isdigit);
-
-		if (is_number) {
-			std::string filename = input.substr(0, colon_pos);
-			uint32_t line_no = (uint32_t)std::stoi(line_str);
-			bp = target.BreakpointCreateByLocation(filename.c_str(), line_no);
-			if (bp.IsValid() && bp.GetNumLocations() > 0) return bp;
-		}
+	BreakpointSpec spec = parse_breakpoint_spec(input);
+	SBBreakpoint bp = create_breakpoint_at(target, spec.location);
+	if (bp.IsValid()) {
+		if (!spec.condition.empty()) bp.SetCondition(spec.condition.c_str());
+		if (spec.ignore_count > 0) bp.SetIgnoreCount(spec.ignore_count);
+		if (!spec.log_expressions.empty()) logpoints.attach(bp, spec.log_expressions);
 	}
-
-	return target.BreakpointCreateByName(input.c_str());
+	return bp;
 }
 
-void draw_log_view(int x, int y, int w, int h, const std::vector<std::string>& log_buffer, InputMode mode, const std::string& input_buffer, int scroll_offset) {
-	bool input_mode = (mode == INPUT_MODE_BREAKPOINT || mode == INPUT_MODE_VARIABLE || mode == INPUT_MODE_WATCH);
+
+void draw_log_view(int x, int y, int w, int h, const LogBuffer& log_buffer, InputMode mode, const std::string& input_buffer, int scroll_offset) {
+	bool input_mode = (mode == INPUT_MODE_BREAKPOINT || mode == INPUT_MODE_VARIABLE || mode == INPUT_MODE_WATCH || mode == INPUT_MODE_WATCHPOINT || mode == INPUT_MODE_MEMORY);
 	std::string title = input_mode ? "Input (Esc to Cancel)" : "Logs";
 	if (!input_mode && scroll_offset > 0) {
 		title += " (Scrolled up: " + std::to_string(scroll_offset) + ")";
@@ -609,6 +2545,8 @@ void draw_log_view(int x, int y, int w, int h, const std::vector<std::string>& l
 		if (mode == INPUT_MODE_BREAKPOINT) prompt = "Add Breakpoint: ";
 		else if (mode == INPUT_MODE_VARIABLE) prompt = "Print Variable: ";
 		else if (mode == INPUT_MODE_WATCH) prompt = "Watch Variable: ";
+		else if (mode == INPUT_MODE_WATCHPOINT) prompt = "Add Watchpoint (expr [r|w|rw] [size=N]): ";
+		else if (mode == INPUT_MODE_MEMORY) prompt = "Show Memory (address or expr): ";
 
 		prompt += input_buffer;
 		if ((int)prompt.length() > cw) prompt = prompt.substr(prompt.length() - cw);
@@ -622,8 +2560,7 @@ void draw_log_view(int x, int y, int w, int h, const std::vector<std::string>& l
 			int log_idx = total_logs - display_count - scroll_offset + i;
 			if (log_idx < 0 || log_idx >= total_logs) continue;
 
-			const std::string& msg = log_buffer[log_idx];
-			std::string disp = msg;
+			std::string disp = log_buffer.line(log_idx);
 			if ((int)disp.length() > cw) disp = disp.substr(0, cw);
 			draw_text(cx, cy + i, TB_DEFAULT, TB_DEFAULT, disp);
 		}
@@ -650,17 +2587,11 @@ void draw_log_view(int x, int y, int w, int h, const std::vector<std::string>& l
 
 void draw_help_view(int width, int height) {
 	int w = 60;
-	int h = 18;
+	int h = 30;
 	int x = (width - w) / 2;
 	int y = (height - h) / 2;
 
-	// Fill background
-	for (int i = 0; i < h; ++i) {
-		for (int j = 0; j < w; ++j) {
-			tb_set_cell(x + j, y + i, ' ', TB_DEFAULT, TB_DEFAULT);
-		}
-	}
-
+	clear_rect(x, y, w, h);
 	draw_box(x, y, w, h, "Help / Keybinds");
 
 	int ty = y + 2;
@@ -676,34 +2607,102 @@ void draw_help_view(int width, int height) {
 	d("b", "Add breakpoint (file:line or func)");
 	d("p", "Print variable / Evaluate expr");
 	d("w", "Add watch expression");
+	d("W", "Add watchpoint (expr [r|w|rw] [size=N])");
+	d("R", "Re-evaluate watch expressions");
 	d("n", "Step Over (next line)");
 	d("s", "Step Into (into function)");
 	d("o", "Step Out (to caller)");
+	d("N / S", "Step over / into one instruction");
 	d("c", "Continue execution");
+	d("u", "Run to the clicked source line");
+	d("<N>n/s/o", "Repeat a step N times, e.g. 100n");
+	d("i", "Interrupt running program");
 	d("h", "Toggle help window");
+	d("a", "Toggle disassembly view");
+	d("m", "Show memory at address / Close memory");
+	d("Tab", "Next tab in the lower sidebar");
+	d("F2", "Toggle frame / LLDB stats");
 	d("q", "Quit debugger");
 	d("Esc", "Cancel input / Close help");
 	d("Ctrl+Arrows", "Resize layout");
 	d("Mouse Wheel", "Scroll active window");
+	d("Mouse Click", "Expand a variable / Set source cursor");
+	d("Right Click", "Show memory of a variable in Locals");
 
 	draw_text(x + (w - 24) / 2, y + h - 2, TB_BLACK, TB_WHITE, " Press any key to close ");
 }
 
-void draw_status_bar(SBProcess &process, InputMode mode, int width, int height) {
+void draw_stats_view(int x, int y) {
+	int w = 46;
+	int h = PANE_COUNT + LLDB_CALL_COUNT + 7;
+	clear_rect(x, y, w, h);
+	draw_box(x, y, w, h, "Stats (F2)");
+
+	FrameSample avg = stats.average();
+	char buf[96];
+	int ty = y + 1;
+
+	snprintf(buf, sizeof(buf), "%-20s %10s %10s", "Pane (last frames)", "avg ms", "max ms");
+	draw_text(x + 2, ty++, TB_YELLOW | TB_BOLD, TB_DEFAULT, buf);
+	for (int i = 0; i < PANE_COUNT; ++i) {
+		snprintf(buf, sizeof(buf), "%-20s %10.2f %10.2f", PANE_NAMES[i], avg.pane_ms[i], stats.max_pane_ms(i));
+		draw_text(x + 2, ty++, TB_DEFAULT, TB_DEFAULT, buf);
+	}
+
+	ty++;
+	snprintf(buf, sizeof(buf), "%-20s %10s %10s", "LLDB per frame", "calls", "ms");
+	draw_text(x + 2, ty++, TB_YELLOW | TB_BOLD, TB_DEFAULT, buf);
+	for (int i = 0; i < LLDB_CALL_COUNT; ++i) {
+		snprintf(buf, sizeof(buf), "%-20s %10llu %10.2f", LLDB_CALL_NAMES[i], (unsigned long long)avg.lldb_calls[i], avg.lldb_ms[i]);
+		draw_text(x + 2, ty++, TB_DEFAULT, TB_DEFAULT, buf);
+	}
+
+	ty++;
+	snprintf(buf, sizeof(buf), "%-20s %10llu", "tb_present bytes", (unsigned long long)avg.present_bytes);
+	draw_text(x + 2, ty, TB_DEFAULT, TB_DEFAULT, buf);
+}
+
+std::string get_state_name(StateType state) {
+	switch (state) {
+		case eStateStopped: return "Stopped";
+		case eStateRunning: return "Running";
+		case eStateStepping: return "Stepping";
+		case eStateLaunching: return "Launching";
+		case eStateAttaching: return "Attaching";
+		case eStateCrashed: return "Crashed";
+		case eStateExited: return "Exited";
+		default: return "Unknown";
+	}
+}
+
+bool is_stopped_state(StateType state) {
+	return state == eStateStopped || state == eStateCrashed;
+}
+
+void draw_status_bar(SBProcess &process, bool core_mode, InputMode mode, int repeat_count, const std::string& progress, int width, int height) {
 	std::string state_str = "Status: ";
-	if (!process.IsValid()) {
+	if (!progress.empty()) {
+		state_str += progress;
+	} else if (!process.IsValid()) {
 		state_str += "Not Running";
+	} else if (core_mode) {
+		state_str += "Core file";
 	} else {
-		StateType state = process.GetState();
-		if (state == eStateStopped) state_str += "Stopped";
-		else if (state == eStateRunning) state_str += "Running";
-		else if (state == eStateExited) state_str += "Exited";
-		else state_str += "Unknown";
+		state_str += get_state_name(process.GetState());
+	}
+	if (repeat_count > 0) {
+		state_str += " | Count: " + std::to_string(repeat_count);
 	}
 
-	state_str += (mode == INPUT_MODE_NORMAL)
-		? " | r=Run, b=Add bp, p=Print, w=Watch, n=Step, s=Step In, o=Step Out, c=Cont, h=Help, q=Quit"
-		: (mode == INPUT_MODE_HELP ? " | Press any key to close help" : " | Enter=Confirm, Esc=Cancel");
+	if (mode == INPUT_MODE_NORMAL && core_mode) {
+		state_str += " | b=Add bp, p=Print, w=Watch, R=Refresh, Tab=Next tab, h=Help, q=Quit";
+	} else if (mode == INPUT_MODE_NORMAL) {
+		state_str += " | r=Run, b=Add bp, p=Print, w=Watch, W=Watchpoint, R=Refresh, Tab=Next tab, n=Step, s=Step In, o=Step Out, N/S=Step insn, a=Asm, m=Memory, c=Cont, u=Run to cursor, i=Interrupt, h=Help, q=Quit";
+	} else if (mode == INPUT_MODE_HELP) {
+		state_str += " | Press any key to close help";
+	} else {
+		state_str += " | Enter=Confirm, Esc=Cancel";
+	}
 
 	for (int x = 0; x < width; ++x) {
 		tb_set_cell(x, height - 1, ' ', TB_BLACK, TB_WHITE);
@@ -712,7 +2711,7 @@ void draw_status_bar(SBProcess &process, InputMode mode, int width, int height)
 	draw_text(1, height - 1, TB_BLACK, TB_WHITE, state_str);
 }
 
-SBProcess launch_target(SBTarget& target, const std::string& target_path, const std::vector<std::string>& debuggee_args, const std::vector<std::string>& target_env, std::vector<std::string>& log_buffer) {
+SBProcess launch_target(SBTarget& target, const std::string& target_path, const std::vector<std::string>& debuggee_args, const std::vector<std::string>& target_env, LogBuffer& log_buffer, const char* output_path = nullptr) {
 	if (target.GetNumBreakpoints() == 0) {
 		SBBreakpoint bp = target.BreakpointCreateByName("main");
 		if (bp.IsValid() && bp.GetNumLocations() > 0) {
@@ -739,6 +2738,12 @@ SBProcess launch_target(SBTarget& target, const std::string& target_path, const
 	SBLaunchInfo launch_info(launch_argv.data());
 	launch_info.SetEnvironmentEntries(launch_env.data(), true);
 	launch_info.SetWorkingDirectory(".");
+	if (output_path) {
+		// Keeps the debuggee from writing into our own stdout
+		launch_info.AddOpenFileAction(STDOUT_FILENO, output_path, false, true);
+		launch_info.AddOpenFileAction(STDIN_FILENO, "/dev/null", true, false);
+		launch_info.AddDuplicateFileAction(STDOUT_FILENO, STDERR_FILENO);
+	}
 
 	SBError error;
 	SBProcess process = target.Launch(launch_info, error);
@@ -756,12 +2761,458 @@ SBProcess launch_target(SBTarget& target, const std::string& target_path, const
 	return process;
 }
 
+SBProcess attach_process(SBTarget& target, lldb::pid_t pid, LogBuffer& log_buffer) {
+	log_msg(log_buffer, "Attaching to " + std::to_string(pid) + "...");
+	SBListener listener = target.GetDebugger().GetListener();
+	SBError error;
+	SBProcess process = target.AttachToProcessWithID(listener, pid, error);
+	if (!process.IsValid() || error.Fail()) {
+		log_msg(log_buffer, "Attach failed: " + std::string(error.GetCString() ? error.GetCString() : "unknown error"));
+	} else {
+		log_msg(log_buffer, "Attached to " + std::to_string(pid));
+	}
+	return process;
+}
+
+SBProcess load_core(SBTarget& target, const std::string& core_path, LogBuffer& log_buffer) {
+	SBError error;
+	SBProcess process = target.LoadCore(core_path.c_str(), error);
+	if (!process.IsValid() || error.Fail()) {
+		log_msg(log_buffer, "Loading core failed: " + std::string(error.GetCString() ? error.GetCString() : "unknown error"));
+	} else {
+		log_msg(log_buffer, "Loaded core file " + core_path);
+	}
+	return process;
+}
+
+// Launched programs die with the debugger, attached ones are left running
+void release_process(SBProcess& process, bool attached) {
+	if (!process.IsValid()) return;
+	StateType state = process.GetState();
+	if (state == eStateExited || state == eStateDetached) return;
+	if (attached) {
+		process.Detach();
+	} else {
+		process.Kill();
+	}
+}
+
+// Keys and batch commands that need a live process
+bool is_run_control(uint32_t ch) {
+	return ch == 'r' || ch == 'n' || ch == 's' || ch == 'o' || ch == 'N' || ch == 'S' || ch == 'c' || ch == 'u' || ch == 'i' || ch == 'W' || (ch >= '0' && ch <= '9');
+}
+
+void step_thread(SBThread& thread, char command) {
+	switch (command) {
+		case 'n': thread.StepOver(); break;
+		case 's': thread.StepInto(); break;
+		case 'o': thread.StepOut(); break;
+		case 'N': thread.StepInstruction(true); break;
+		case 'S': thread.StepInstruction(false); break;
+	}
+}
+
+// Repeats a step command N times from the event loop. The intermediate stops
+// re-issue the step straight away and never reach the log or the panes, so
+// only the final stop is drawn. Anything other than a finished step (a
+// breakpoint, a signal, an exit) ends the repeat early.
+struct StepRepeat {
+	char command = 0;
+	int remaining = 0;
+
+	bool active() const { return remaining > 0; }
+
+	void start(SBThread& thread, char cmd, int count) {
+		command = cmd;
+		remaining = count - 1;
+		step_thread(thread, command);
+	}
+
+	void cancel() { remaining = 0; }
+
+	// Returns true if the event was an intermediate stop and has been handled
+	bool consume(SBEvent& event) {
+		if (!active()) return false;
+		if (!(event.GetType() & SBProcess::eBroadcastBitStateChanged)) return false;
+
+		StateType state = SBProcess::GetStateFromEvent(event);
+		if (state == eStateRunning || state == eStateStepping) return true;
+		if (state == eStateStopped && SBProcess::GetRestartedFromEvent(event)) return true;
+		if (state != eStateStopped) {
+			cancel();
+			return false;
+		}
+
+		SBThread thread = SBProcess::GetProcessFromEvent(event).GetSelectedThread();
+		StopReason reason = thread.GetStopReason();
+		if (reason != eStopReasonPlanComplete && reason != eStopReasonTrace && reason != eStopReasonNone) {
+			cancel();
+			return false;
+		}
+
+		remaining--;
+		step_thread(thread, command);
+		return true;
+	}
+};
+
+// Runs to a line. Lines in the current function are reached with
+// StepOverUntil, anything else through a one-shot breakpoint limited to this
+// thread. That breakpoint is removed at the next stop even when the program
+// stopped somewhere else first, so it can't fire on a later continue.
+struct RunToLine {
+	break_id_t id = 0;
+
+	bool start(SBProcess& process, SBThread& thread, SBFrame& frame, const std::string& path, int line, LogBuffer& log_buffer) {
+		SBTarget target = process.GetTarget();
+		SBBreakpoint bp = target.BreakpointCreateByLocation(path.c_str(), (uint32_t)line);
+		if (!bp.IsValid() || bp.GetNumLocations() == 0) {
+			if (bp.IsValid()) target.BreakpointDelete(bp.GetID());
+			log_msg(log_buffer, "No code at line " + std::to_string(line));
+			return false;
+		}
+		log_msg(log_buffer, "Running to line " + std::to_string(line));
+
+		if (in_function(target, frame, bp)) {
+			target.BreakpointDelete(bp.GetID());
+			SBFileSpec file_spec = frame.GetLineEntry().GetFileSpec();
+			SBError error = thread.StepOverUntil(frame, file_spec, (uint32_t)line);
+			if (error.Fail()) {
+				log_msg(log_buffer, "Run to line failed: " + std::string(error.GetCString() ? error.GetCString() : ""));
+				return false;
+			}
+			return true;
+		}
+
+		bp.SetOneShot(true);
+		bp.SetThreadID(thread.GetThreadID());
+		id = bp.GetID();
+		process.Continue();
+		return true;
+	}
+
+	// Called for every stop and exit, whatever caused it
+	void finish(SBTarget target) {
+		if (id == 0) return;
+		target.BreakpointDelete(id);
+		id = 0;
+	}
+
+private:
+	static bool in_function(SBTarget& target, SBFrame& frame, SBBreakpoint& bp) {
+		SBFunction function = frame.GetFunction();
+		if (!function.IsValid()) return false;
+		addr_t start = function.GetStartAddress().GetLoadAddress(target);
+		addr_t end = function.GetEndAddress().GetLoadAddress(target);
+		for (uint32_t i = 0; i < bp.GetNumLocations(); ++i) {
+			addr_t addr = bp.GetLocationAtIndex(i).GetAddress().GetLoadAddress(target);
+			if (addr < start || addr >= end) return false;
+		}
+		return true;
+	}
+};
+
+void handle_process_event(SBEvent& event, LogBuffer& log_buffer) {
+	if (!SBProcess::EventIsProcessEvent(event)) return;
+	if (!(event.GetType() & SBProcess::eBroadcastBitStateChanged)) return;
+	if (SBProcess::GetRestartedFromEvent(event)) return;
+
+	StateType state = SBProcess::GetStateFromEvent(event);
+	SBProcess process = SBProcess::GetProcessFromEvent(event);
+	if (state == eStateExited) {
+		log_msg(log_buffer, "Process exited with status " + std::to_string(process.GetExitStatus()));
+	} else if (is_stopped_state(state)) {
+		// Plain step completions are not worth a log line, everything else is
+		SBThread thread = process.GetSelectedThread();
+		StopReason reason = thread.GetStopReason();
+		if (reason != eStopReasonPlanComplete && reason != eStopReasonTrace && reason != eStopReasonNone) {
+			char desc[256] = {0};
+			thread.GetStopDescription(desc, sizeof(desc));
+			log_msg(log_buffer, "Stopped: " + std::string(desc));
+		}
+	}
+}
+
+std::string json_string(const std::string& str) {
+	std::string out = "\"";
+	for (unsigned char c : str) {
+		switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (c < 0x20) {
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", c);
+					out += buf;
+				} else {
+					out += (char)c;
+				}
+		}
+	}
+	return out + "\"";
+}
+
+// Same depth limit as format_variable_log, children capped at one page
+std::string value_to_json(SBValue val, const std::string& name_override = "", int depth = 0) {
+	std::string name = name_override.empty() ? (val.GetName() ? val.GetName() : "") : name_override;
+	std::string json = "{\"name\":" + json_string(name);
+	json += ",\"type\":" + json_string(val.GetTypeName() ? val.GetTypeName() : "");
+	json += ",\"value\":" + json_string(format_value(val));
+
+	uint32_t num_children = val.GetNumChildren();
+	if (num_children > 0) {
+		json += ",\"num_children\":" + std::to_string(num_children);
+		if (depth < 3) {
+			json += ",\"children\":[";
+			uint32_t shown = std::min<uint32_t>(num_children, CHILD_PAGE_SIZE);
+			for (uint32_t i = 0; i < shown; ++i) {
+				SBValue child;
+				{
+					LLDBTimer timer(LLDB_CHILD_AT_INDEX);
+					child = val.GetChildAtIndex(i);
+				}
+				if (i > 0) json += ",";
+				json += value_to_json(child, "", depth + 1);
+			}
+			json += "]";
+		}
+	}
+	return json + "}";
+}
+
+std::string stop_to_json(SBProcess& process, const std::vector<WatchExpression>& watch_expressions) {
+	SBThread thread = process.GetSelectedThread();
+	SBFrame frame = thread.GetSelectedFrame();
+
+	char desc[256] = {0};
+	thread.GetStopDescription(desc, sizeof(desc));
+
+	std::string json = "{\"type\":\"stop\",\"state\":" + json_string(get_state_name(process.GetState()));
+	json += ",\"reason\":" + json_string(desc);
+	json += ",\"thread\":" + std::to_string(thread.GetIndexID());
+	json += ",\"function\":" + json_string(frame.GetFunctionName() ? frame.GetFunctionName() : "");
+
+	SBLineEntry line_entry = frame.GetLineEntry();
+	if (line_entry.IsValid()) {
+		json += ",\"file\":" + json_string(get_full_path(line_entry.GetFileSpec()));
+		json += ",\"line\":" + std::to_string(line_entry.GetLine());
+	}
+	json += ",\"pc\":" + std::to_string(frame.GetPC());
+
+	json += ",\"locals\":[";
+	SBValueList vars;
+	{
+		LLDBTimer timer(LLDB_GET_VARIABLES);
+		vars = frame.GetVariables(true, true, false, true);
+	}
+	for (uint32_t i = 0; i < vars.GetSize(); ++i) {
+		if (i > 0) json += ",";
+		json += value_to_json(vars.GetValueAtIndex(i));
+	}
+	json += "]";
+
+	json += ",\"watches\":[";
+	for (size_t i = 0; i < watch_expressions.size(); ++i) {
+		bool used_path = false;
+		SBValue val = evaluate_expression(frame, watch_expressions[i], used_path);
+		if (i > 0) json += ",";
+		if (val.IsValid() && !val.GetError().Fail()) {
+			json += value_to_json(val, watch_expressions[i].text);
+		} else {
+			const char* err = val.GetError().GetCString();
+			json += "{\"name\":" + json_string(watch_expressions[i].text) + ",\"error\":" + json_string(err ? err : "invalid expression") + "}";
+		}
+	}
+	json += "]}";
+	return json;
+}
+
+// Runs the same command vocabulary as the interactive keys, one command per
+// line, and writes one JSON object per line to stdout. LLDB is in sync mode
+// here so every run-control command returns only once the process stopped.
+int run_batch(std::istream& script, SBTarget& target, SBProcess& process, bool core_mode, const std::string& target_path, const std::vector<std::string>& debuggee_args, const std::vector<std::string>& target_env, const std::string& output_path, LogBuffer& log_buffer) {
+	std::vector<WatchExpression> watch_expressions;
+	uint64_t logged = 0;
+	int errors = 0;
+
+	auto emit = [](const std::string& json) {
+		std::cout << json << "\n";
+	};
+	auto emit_error = [&](const std::string& command, const std::string& message) {
+		emit("{\"type\":\"error\",\"command\":" + json_string(command) + ",\"message\":" + json_string(message) + "}");
+		errors++;
+	};
+	auto flush_log = [&]() {
+		logpoints.drain(log_buffer);
+		// Records that already fell out of the ring are skipped
+		logged = std::max<uint64_t>(logged, log_buffer.appended - log_buffer.size());
+		for (; logged < log_buffer.appended; ++logged) {
+			emit("{\"type\":\"log\",\"message\":" + json_string(log_buffer[log_buffer.size() - (log_buffer.appended - logged)].text) + "}");
+		}
+		std::cout.flush();
+	};
+	// Each reported stop counts as one frame in the stats, command_ms is the
+	// time LLDB took to get there and render_ms the time to serialize it
+	auto report_state = [&](std::chrono::steady_clock::time_point command_start) {
+		if (!process.IsValid()) return;
+		StateType state = process.GetState();
+		if (state == eStateExited) {
+			emit("{\"type\":\"exit\",\"status\":" + std::to_string(process.GetExitStatus()) + "}");
+		} else if (is_stopped_state(state)) {
+			double command_ms = elapsed_ms(command_start);
+			auto render_start = std::chrono::steady_clock::now();
+			std::string json = stop_to_json(process, watch_expressions);
+			double render_ms = elapsed_ms(render_start);
+
+			uint64_t lldb_calls = 0;
+			for (int i = 0; i < LLDB_CALL_COUNT; ++i) lldb_calls += stats.current.lldb_calls[i];
+			stats.end_frame();
+
+			char timing[128];
+			snprintf(timing, sizeof(timing), ",\"command_ms\":%.3f,\"render_ms\":%.3f,\"lldb_calls\":%llu}", command_ms, render_ms, (unsigned long long)lldb_calls);
+			json.pop_back();
+			emit(json + timing);
+		}
+	};
+
+	// A process from -run, -p or -c is already stopped somewhere
+	report_state(std::chrono::steady_clock::now());
+	flush_log();
+	std::string line;
+	while (std::getline(script, line)) {
+		size_t begin = line.find_first_not_of(" \t\r");
+		if (begin == std::string::npos || line[begin] == '#') continue;
+		size_t end = line.find_last_not_of(" \t\r");
+		line = line.substr(begin, end - begin + 1);
+
+		size_t space = line.find_first_of(" \t");
+		std::string command = line.substr(0, space);
+		std::string arg;
+		if (space != std::string::npos) {
+			arg = line.substr(line.find_first_not_of(" \t", space));
+		}
+
+		// Numeric prefix as in the UI, "100n" steps over 100 times
+		size_t digits = command.find_first_not_of("0123456789");
+		int count = 1;
+		if (digits > 0 && digits != std::string::npos) {
+			count = std::max(1, atoi(command.substr(0, digits).c_str()));
+			command = command.substr(digits);
+		}
+
+		auto command_start = std::chrono::steady_clock::now();
+		bool stopped = process.IsValid() && is_stopped_state(process.GetState());
+		if (command == "q") {
+			break;
+		} else if (core_mode && command.size() == 1 && is_run_control(command[0])) {
+			emit_error(line, "Not available for a core file");
+		} else if (command == "b") {
+			SBBreakpoint bp = create_breakpoint(target, arg);
+			if (bp.IsValid() && bp.GetNumLocations() > 0) {
+				emit("{\"type\":\"breakpoint\",\"spec\":" + json_string(arg) + ",\"id\":" + std::to_string(bp.GetID()) + ",\"locations\":" + std::to_string(bp.GetNumLocations()) + "}");
+			} else {
+				emit_error(line, "Failed/Invalid breakpoint");
+			}
+		} else if (command == "r") {
+			if (process.IsValid() && process.GetState() != eStateExited) {
+				emit_error(line, "Process is already running");
+			} else {
+				process = launch_target(target, target_path, debuggee_args, target_env, log_buffer, output_path.c_str());
+				report_state(command_start);
+			}
+		} else if (command == "n" || command == "s" || command == "o" || command == "N" || command == "S" || command == "c") {
+			if (!stopped) {
+				emit_error(line, "Process is not stopped");
+			} else {
+				if (command == "c") {
+					process.Continue();
+				} else {
+					// Only the last of the repeated steps is reported
+					for (int step = 0; step < count; ++step) {
+						SBThread thread = process.GetSelectedThread();
+						if (step > 0) {
+							if (!is_stopped_state(process.GetState())) break;
+							StopReason reason = thread.GetStopReason();
+							if (reason != eStopReasonPlanComplete && reason != eStopReasonTrace && reason != eStopReasonNone) break;
+						}
+						step_thread(thread, command[0]);
+					}
+				}
+				report_state(command_start);
+			}
+		} else if (command == "p") {
+			SBFrame frame = stopped ? process.GetSelectedThread().GetSelectedFrame() : SBFrame();
+			if (!frame.IsValid()) {
+				emit_error(line, "No stack frame available");
+			} else {
+				WatchExpression expr(arg);
+				bool used_path = false;
+				SBValue val = evaluate_expression(frame, expr, used_path);
+				if (val.IsValid() && !val.GetError().Fail()) {
+					emit("{\"type\":\"print\",\"by_path\":" + std::string(used_path ? "true" : "false") + ",\"value\":" + value_to_json(val, arg) + "}");
+				} else {
+					const char* err = val.GetError().GetCString();
+					emit_error(line, err ? err : "invalid expression");
+				}
+			}
+		} else if (command == "W") {
+			SBFrame frame = stopped ? process.GetSelectedThread().GetSelectedFrame() : SBFrame();
+			SBError error;
+			SBWatchpoint wp = create_watchpoint(target, frame, arg, error);
+			if (wp.IsValid() && error.Success()) {
+				emit("{\"type\":\"watchpoint\",\"spec\":" + json_string(arg) + ",\"id\":" + std::to_string(wp.GetID()) + ",\"address\":" + std::to_string(wp.GetWatchAddress()) + ",\"size\":" + std::to_string(wp.GetWatchSize()) + "}");
+			} else {
+				emit_error(line, error.GetCString() ? error.GetCString() : "Failed to add watchpoint");
+			}
+		} else if (command == "w") {
+			if (arg.empty()) {
+				emit_error(line, "Missing expression");
+			} else {
+				watch_expressions.emplace_back(arg);
+			}
+		} else {
+			emit_error(line, "Unknown command");
+		}
+
+		flush_log();
+	}
+
+	// Session totals, ru_maxrss is in kilobytes on Linux and bytes on macOS
+	struct rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	long max_rss_kb = usage.ru_maxrss / 1024;
+#else
+	long max_rss_kb = usage.ru_maxrss;
+#endif
+	std::string json = "{\"type\":\"stats\",\"stops\":" + std::to_string(stats.frames) + ",\"max_rss_kb\":" + std::to_string(max_rss_kb) + ",\"lldb\":{";
+	for (int i = 0; i < LLDB_CALL_COUNT; ++i) {
+		char entry[128];
+		snprintf(entry, sizeof(entry), "%s\"%s\":{\"calls\":%llu,\"ms\":%.3f}", i > 0 ? "," : "", LLDB_CALL_NAMES[i], (unsigned long long)stats.totals.lldb_calls[i], stats.totals.lldb_ms[i]);
+		json += entry;
+	}
+	emit(json + "}}");
+	std::cout.flush();
+
+	return errors > 0 ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
 	std::vector<std::string> target_env;
 	std::vector<std::string> startup_breakpoints;
 	std::vector<std::string> debuggee_args;
 	std::string target_path;
 	bool auto_run = false;
+	int source_cache_mb = 64;
+	std::string batch_script;
+	std::string batch_output = "tdbg.out";
+	int log_lines = 10000;
+	bool log_spill = false;
+	lldb::pid_t attach_pid = 0;
+	std::string core_path;
 
 	for (int i = 1; i < argc; ++i) {
 		std::string arg = argv[i];
@@ -771,13 +3222,34 @@ int main(int argc, char** argv) {
 			startup_breakpoints.push_back(argv[++i]);
 		} else if (arg == "-run") {
 			auto_run = true;
+		} else if (arg == "-source-cache-mb" && i + 1 < argc) {
+			source_cache_mb = std::max(1, atoi(argv[++i]));
+		} else if (arg == "-log-lines" && i + 1 < argc) {
+			log_lines = std::max(1, atoi(argv[++i]));
+		} else if (arg == "-p" && i + 1 < argc) {
+			attach_pid = strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "-c" && i + 1 < argc) {
+			core_path = argv[++i];
+		} else if (arg == "-log-spill") {
+			log_spill = true;
+		} else if (arg == "-batch" && i + 1 < argc) {
+			batch_script = argv[++i];
+		} else if (arg == "-batch-output" && i + 1 < argc) {
+			batch_output = argv[++i];
 		} else if (arg == "-h" || arg == "--help") {
 			std::cout << "Usage: " << argv[0] << " [options] <target_executable> [-- arg1 arg2 ...]\n\n"
 					  << "Options:\n"
-					  << "  -e KEY=VALUE      Set environment variable\n"
-					  << "  -b BREAKPOINT     Set startup breakpoint (name or file:line)\n"
-					  << "  -run              Automatically run the target on startup\n"
-					  << "  -h, --help        Show this help message\n";
+					  << "  -e KEY=VALUE        Set environment variable\n"
+					  << "  -b BREAKPOINT       Set startup breakpoint (name or file:line, [if COND] [ignore=N])\n"
+					  << "  -run                Automatically run the target on startup\n"
+					  << "  -p PID              Attach to a running process\n"
+					  << "  -c CORE             Inspect a core file (run control is disabled)\n"
+					  << "  -source-cache-mb N  Memory budget for cached source files (default 64)\n"
+					  << "  -log-lines N        Number of log lines kept in memory (default 10000)\n"
+					  << "  -log-spill          Append log lines dropped from memory to tdbg.log\n"
+					  << "  -batch FILE         Run commands from FILE (- for stdin) and print JSON Lines\n"
+					  << "  -batch-output FILE  Where the program's output goes in batch mode (default tdbg.out)\n"
+					  << "  -h, --help          Show this help message\n";
 			return 0;
 		} else if (arg == "--") {
 			for (int j = i + 1; j < argc; ++j) {
@@ -791,8 +3263,9 @@ int main(int argc, char** argv) {
 		}
 	}
 
-	if (target_path.empty()) {
-		std::cerr << "Usage: " << argv[0] << " [-e KEY=VALUE] [-b BREAKPOINT] [-run] ... <target_executable> [-- arg1 arg2 ...]\n";
+	// An attached process brings its own executable
+	if (target_path.empty() && attach_pid == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-e KEY=VALUE] [-b BREAKPOINT] [-run] [-p PID] [-c CORE] ... <target_executable> [-- arg1 arg2 ...]\n";
 		return 1;
 	}
 
@@ -804,49 +3277,122 @@ int main(int argc, char** argv) {
 
 	LLDBGuard lldb_guard;
 	SBDebugger debugger = SBDebugger::Create();
-	debugger.SetAsync(false); 
+	debugger.SetAsync(batch_script.empty());
 
-	SBTarget target = debugger.CreateTarget(target_path.c_str());
-	if (!target.IsValid()) {
-		std::cerr << "Failed to create target for " << target_path << "\n";
-		return 1;
-	}
+	LogBuffer log_buffer(log_lines);
+	if (log_spill) log_buffer.spill = std::make_unique<LogSpill>();
 
-	std::vector<std::string> log_buffer;
-	for (const auto& bp_spec : startup_breakpoints) {
-		SBBreakpoint bp = create_breakpoint(target, bp_spec);
-		if (bp.IsValid() && bp.GetNumLocations() > 0) {
-			log_msg(log_buffer, "Set startup breakpoint: " + bp_spec);
-		} else {
-			log_msg(log_buffer, "Failed to set startup breakpoint: " + bp_spec);
+	bool core_mode = !core_path.empty();
+	SBTarget target;
+	SBProcess process;
+
+	// Everything the command line asked for that needs the target
+	auto start_target = [&] {
+		// Batch mode runs synchronously and never reads these events
+		if (batch_script.empty()) {
+			debugger.GetListener().StartListeningForEvents(target.GetBroadcaster(), SBTarget::eBroadcastBitBreakpointChanged | SBTarget::eBroadcastBitWatchpointChanged);
 		}
-	}
+		for (const auto& bp_spec : startup_breakpoints) {
+			SBBreakpoint bp = create_breakpoint(target, bp_spec);
+			if (bp.IsValid() && bp.GetNumLocations() > 0) {
+				log_msg(log_buffer, "Set startup breakpoint: " + bp_spec);
+			} else {
+				log_msg(log_buffer, "Failed to set startup breakpoint: " + bp_spec);
+			}
+		}
+		startup_breakpoints.clear();
+
+		if (attach_pid > 0) {
+			process = attach_process(target, attach_pid, log_buffer);
+		} else if (core_mode) {
+			process = load_core(target, core_path, log_buffer);
+		} else if (auto_run) {
+			process = launch_target(target, target_path, debuggee_args, target_env, log_buffer, batch_script.empty() ? nullptr : batch_output.c_str());
+		}
+	};
 
-	SBProcess process;
-	if (auto_run) {
-		process = launch_target(target, target_path, debuggee_args, target_env, log_buffer);
+	if (!batch_script.empty()) {
+		target = debugger.CreateTarget(target_path.c_str());
+		if (!target.IsValid()) {
+			std::cout << "{\"type\":\"error\",\"command\":\"\",\"message\":" << json_string("Failed to create target for " + target_path) << "}\n";
+			return 1;
+		}
+		start_target();
+
+		std::ifstream script_file;
+		if (batch_script != "-") {
+			script_file.open(batch_script);
+			if (!script_file) {
+				std::cout << "{\"type\":\"error\",\"command\":\"\",\"message\":" << json_string("Cannot open " + batch_script) << "}\n";
+				return 1;
+			}
+		}
+		int result = run_batch(batch_script == "-" ? std::cin : script_file, target, process, core_mode, target_path, debuggee_args, target_env, batch_output, log_buffer);
+		if (!core_mode) release_process(process, attach_pid > 0);
+		return result;
 	}
 
+	EventPump event_pump(debugger.GetListener());
+	debugger.GetListener().StartListeningForEventClass(debugger, SBThread::GetBroadcasterClassName(), SBThread::eBroadcastBitStackChanged | SBThread::eBroadcastBitThreadSelected | SBThread::eBroadcastBitSelectedFrameChanged);
+	debugger.GetListener().StartListeningForEvents(debugger.GetBroadcaster(), SBDebugger::eBroadcastBitProgress);
+	SBBroadcaster debugger_broadcaster = debugger.GetBroadcaster();
+	ProgressState progress;
+	TargetLoader loader(debugger, target_path, event_pump);
+	// Attaching to a pid doesn't need an executable path
+	std::string target_name = target_path.empty() ? "target" : target_path;
+
 	SBThread thread;
 	TermboxGuard tb_guard;
 
 	bool running = true;
 	InputMode mode = INPUT_MODE_NORMAL;
+	SidebarTab sidebar_tab = TAB_WATCH;
 	std::string input_buffer;
 	std::string current_source_filename;
-	std::vector<std::string> watch_expressions;
+	std::vector<WatchExpression> watch_expressions;
 	int log_scroll_offset = 0;
 	int locals_scroll_offset = 0;
 	int watch_scroll_offset = 0;
 	int source_scroll_offset = 0;
+	int cursor_line = 0;
+	int repeat_count = 0;
+	StepRepeat step_repeat;
+	RunToLine run_to;
+	bool show_disassembly = false;
+	DisasmCache disasm_cache;
+	DisasmView disasm_view;
+	bool show_memory = false;
+	MemoryCache memory_cache;
+	MemoryView memory_view;
 	uint64_t last_pc = 0;
 	SourceCache source_cache;
-	log_buffer.push_back("Debugger started. Press 'b' to add breakpoint, 'r' to run.");
+	source_cache.byte_budget = (size_t)source_cache_mb * 1024 * 1024;
+	BreakpointIndex breakpoint_index;
+	LocalsSnapshot locals_snapshot;
+	WatchSnapshot watch_snapshot;
+	StackSnapshot stack_snapshot;
+	int stack_scroll_offset = 0;
+	ThreadsSnapshot threads_snapshot;
+	int threads_scroll_offset = 0;
+	RegistersSnapshot registers_snapshot;
+	int registers_scroll_offset = 0;
+	DirtyPanes dirty;
+	bool show_stats = false;
+	uint64_t drawn_log_appended = 0;
+	StateType drawn_state = eStateInvalid;
+	log_msg(log_buffer, "Debugger started. Press 'b' to add breakpoint, 'r' to run.");
 
 	tb_set_input_mode(TB_INPUT_ESC | TB_INPUT_MOUSE);
 
+	int tty_fd = -1;
+	int resize_fd = -1;
+	tb_get_fds(&tty_fd, &resize_fd);
+
 	while (running) {
-		tb_clear();
+		if (dirty.clear_screen) {
+			dirty.clear_screen = false;
+			tb_clear();
+		}
 
 		int width = tb_width();
 		int height = tb_height();
@@ -854,8 +3400,9 @@ int main(int argc, char** argv) {
 		int split_x = width - layout_config.sidebar_width;
 		int locals_window_height = main_window_height - layout_config.watch_height;
 
+		// Intermediate stops of a repeated step are not looked at
 		SBFrame frame;
-		if (process.IsValid() && process.GetState() != eStateExited) {
+		if (!step_repeat.active() && process.IsValid() && is_stopped_state(process.GetState())) {
 			thread = process.GetSelectedThread();
 			if (thread.IsValid()) {
 				frame = thread.GetSelectedFrame();
@@ -865,48 +3412,185 @@ int main(int argc, char** argv) {
 						last_pc = current_pc;
 						SBLineEntry le = frame.GetLineEntry();
 						if (le.IsValid()) {
-							std::string fullpath;
-							if (le.GetFileSpec().GetDirectory()) {
-								fullpath = std::string(le.GetFileSpec().GetDirectory()) + "/" + le.GetFileSpec().GetFilename();
-								current_source_filename = le.GetFileSpec().GetFilename();
-							} else {
-								fullpath = le.GetFileSpec().GetFilename();
-								current_source_filename = fullpath;
-							}
-							const std::vector<std::string>& lines = source_cache.get_lines(fullpath);
-							int total_lines = (int)lines.size();
+							std::string fullpath = get_full_path(le.GetFileSpec());
+							if (current_source_filename != le.GetFileSpec().GetFilename()) cursor_line = 0;
+							current_source_filename = le.GetFileSpec().GetFilename();
+							int total_lines = (int)source_cache.get(fullpath).line_count();
 							int ch = main_window_height - 2;
 							source_scroll_offset = std::max(0, (int)le.GetLine() - ch / 2 - 1);
 							if (source_scroll_offset + ch > total_lines) {
 								source_scroll_offset = std::max(0, total_lines - ch);
 							}
+							dirty.mark(PANE_SOURCE);
 						}
 					}
 				}
 			}
 		}
 
-		draw_source_view(frame, 0, 0, split_x, main_window_height, source_cache, source_scroll_offset);
-		draw_variables_view(frame, split_x, 0, layout_config.sidebar_width, locals_window_height, locals_scroll_offset);
-		draw_watch_view(frame, split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height, watch_expressions, watch_scroll_offset);
-		draw_log_view(0, main_window_height, split_x, layout_config.log_height, log_buffer, mode, input_buffer, log_scroll_offset);
-		draw_breakpoints_view(target, split_x, main_window_height, layout_config.sidebar_width, layout_config.log_height);
-		draw_status_bar(process, mode, width, height);
+		bool repainted = false;
+		auto paint = [&](Pane pane, auto draw) {
+			if (!dirty.take(pane)) return;
+			auto start = std::chrono::steady_clock::now();
+			draw();
+			stats.current.pane_ms[pane] += elapsed_ms(start);
+			repainted = true;
+		};
+
+		bool showing_disassembly = !show_memory && frame.IsValid() && (show_disassembly || !has_source(frame, source_cache));
+		paint(PANE_SOURCE, [&] {
+			clear_rect(0, 0, split_x, main_window_height);
+			if (show_memory) {
+				draw_memory_view(process, frame.IsValid(), 0, 0, split_x, main_window_height, memory_cache, memory_view);
+			} else if (showing_disassembly) {
+				draw_disassembly_view(frame, 0, 0, split_x, main_window_height, show_disassembly ? "Disassembly" : "Disassembly (no source)", disasm_cache, disasm_view, source_cache);
+			} else {
+				draw_source_view(frame, 0, 0, split_x, main_window_height, source_cache, breakpoint_index, source_scroll_offset, cursor_line);
+			}
+		});
+		paint(PANE_LOCALS, [&] {
+			clear_rect(split_x, 0, layout_config.sidebar_width, locals_window_height);
+			draw_variables_view(frame, split_x, 0, layout_config.sidebar_width, locals_window_height, locals_snapshot, locals_scroll_offset);
+		});
+		paint(PANE_WATCH, [&] {
+			clear_rect(split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height);
+			std::string title = sidebar_title(sidebar_tab);
+			switch (sidebar_tab) {
+				case TAB_WATCH:
+					draw_watch_view(frame, split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height, title, watch_expressions, watch_snapshot, log_buffer, watch_scroll_offset);
+					break;
+				case TAB_STACK: {
+					// The thread handle is stale while the process runs
+					SBThread stopped_thread = frame.IsValid() ? thread : SBThread();
+					draw_stack_view(stopped_thread, split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height, title, stack_snapshot, stack_scroll_offset);
+					break;
+				}
+				case TAB_THREADS:
+					draw_threads_view(process, frame.IsValid(), split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height, title, threads_snapshot, threads_scroll_offset);
+					break;
+				case TAB_WATCHPOINTS:
+					draw_watchpoints_view(target, split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height, title);
+					break;
+				case TAB_REGISTERS:
+					draw_registers_view(frame, split_x, locals_window_height, layout_config.sidebar_width, layout_config.watch_height, title, registers_snapshot, registers_scroll_offset);
+					break;
+				default: break;
+			}
+		});
+		// Any of the panes above may have logged something
+		if (log_buffer.appended != drawn_log_appended) dirty.mark(PANE_LOG);
+		paint(PANE_LOG, [&] {
+			drawn_log_appended = log_buffer.appended;
+			clear_rect(0, main_window_height, split_x, layout_config.log_height);
+			draw_log_view(0, main_window_height, split_x, layout_config.log_height, log_buffer, mode, input_buffer, log_scroll_offset);
+		});
+		paint(PANE_BREAKPOINTS, [&] {
+			clear_rect(split_x, main_window_height, layout_config.sidebar_width, layout_config.log_height);
+			draw_breakpoints_view(target, split_x, main_window_height, layout_config.sidebar_width, layout_config.log_height);
+		});
+		paint(PANE_STATUS, [&] {
+			std::string status_progress = progress.text();
+			if (loader.loading()) {
+				status_progress = "Loading " + target_name + (status_progress.empty() ? "" : ": " + status_progress);
+			}
+			drawn_state = process.IsValid() ? process.GetState() : eStateInvalid;
+			draw_status_bar(process, core_mode, mode, repeat_count, status_progress, width, height);
+		});
+
+		if (repainted) {
+			if (show_stats) {
+				draw_stats_view(std::max(0, split_x - 47), 1);
+			}
+			if (mode == INPUT_MODE_HELP) {
+				draw_help_view(width, height);
+			}
+			size_t bytes_before = tty_bytes_written;
+			tb_present();
+			stats.current.present_bytes += tty_bytes_written - bytes_before;
+			stats.end_frame();
+		}
+
+		struct pollfd fds[3] = {
+			{tty_fd, POLLIN, 0},
+			{resize_fd, POLLIN, 0},
+			{event_pump.fd(), POLLIN, 0},
+		};
+		// Logpoints fill their buffer without any event, so wake up to drain it
+		int timeout = logpoints.empty() ? -1 : LogpointBuffer::DRAIN_MS;
+		if (poll(fds, 3, timeout) < 0) continue;
+
+		if (logpoints.drain_due() && logpoints.drain(log_buffer) > 0) {
+			dirty.mark(PANE_BREAKPOINTS);
+		}
 
-		if (mode == INPUT_MODE_HELP) {
-			draw_help_view(width, height);
+		SBEvent lldb_event;
+		while (event_pump.pop(lldb_event)) {
+			if (lldb_event.BroadcasterMatchesRef(debugger_broadcaster)) {
+				progress.update(lldb_event);
+				dirty.mark(PANE_STATUS);
+			} else if (SBBreakpoint::EventIsBreakpointEvent(lldb_event)) {
+				breakpoint_index.invalidate();
+				dirty.mark(PANE_SOURCE);
+				dirty.mark(PANE_BREAKPOINTS);
+			} else if (SBWatchpoint::EventIsWatchpointEvent(lldb_event)) {
+				dirty.mark(PANE_WATCH);
+			} else if (SBThread::EventIsThreadEvent(lldb_event)) {
+				// Only the affected row changes, the selection is read at draw time
+				if (lldb_event.GetType() & SBThread::eBroadcastBitStackChanged) {
+					threads_snapshot.invalidate(SBThread::GetThreadFromEvent(lldb_event).GetThreadID());
+				}
+				dirty.mark(PANE_WATCH);
+			} else if (SBProcess::EventIsProcessEvent(lldb_event)) {
+				if (step_repeat.consume(lldb_event)) continue;
+				// Auto-continued logpoint hits produce a restarted stop and a
+				// running event each, those must not repaint everything
+				if (lldb_event.GetType() & SBProcess::eBroadcastBitStateChanged) {
+					StateType state = SBProcess::GetStateFromEvent(lldb_event);
+					if (state == eStateRunning || state == eStateStepping) {
+						// Logpoint hits resume over and over, the bar already says so
+						if (state != drawn_state) dirty.mark(PANE_STATUS);
+					} else if (!SBProcess::GetRestartedFromEvent(lldb_event) && (is_stopped_state(state) || state == eStateExited)) {
+						run_to.finish(target);
+						dirty.mark_all();
+						stack_scroll_offset = 0;
+					}
+				}
+			}
+			handle_process_event(lldb_event, log_buffer);
 		}
 
-		tb_present();
+		if (loader.collect(target)) {
+			dirty.mark_all();
+			if (target.IsValid()) {
+				log_msg(log_buffer, "Loaded " + target_name);
+				start_target();
+			} else {
+				log_msg(log_buffer, "Failed to create target for " + target_name);
+			}
+		}
 
 		struct tb_event ev;
-		if (tb_poll_event(&ev) == 0) {
-			if (ev.type == TB_EVENT_KEY) {
+		while (running && tb_peek_event(&ev, 0) == TB_OK) {
+			if (ev.type == TB_EVENT_RESIZE) {
+				dirty.relayout();
+			} else if (ev.type == TB_EVENT_KEY) {
+				// Keys mostly change the prompt, the mode or log something
+				dirty.mark(PANE_LOG);
+				dirty.mark(PANE_STATUS);
 				if (mode == INPUT_MODE_NORMAL) {
-					if (ev.ch == 'q') {
+					int prefix = repeat_count;
+					repeat_count = 0;
+					if (core_mode && is_run_control(ev.ch)) {
+						log_msg(log_buffer, "Not available for a core file");
+					} else if (ev.ch >= '0' && ev.ch <= '9' && (ev.ch != '0' || prefix > 0)) {
+						repeat_count = std::min(prefix * 10 + (int)(ev.ch - '0'), 1000000);
+					} else if (ev.ch == 'q') {
 						running = false;
 					} else if (ev.ch == 'r') {
-						if (!process.IsValid() || process.GetState() == eStateExited) {
+						if (loader.loading()) {
+							auto_run = true;
+							log_msg(log_buffer, "Will run once the target is loaded");
+						} else if (!process.IsValid() || process.GetState() == eStateExited) {
 							process = launch_target(target, target_path, debuggee_args, target_env, log_buffer);
 						} else {
 							log_msg(log_buffer, "Already running");
@@ -924,35 +3608,88 @@ int main(int argc, char** argv) {
 					} else if (ev.ch == 'w') {
 						mode = INPUT_MODE_WATCH;
 						input_buffer.clear();
+					} else if (ev.ch == 'm') {
+						if (show_memory) {
+							show_memory = false;
+							dirty.mark(PANE_SOURCE);
+						} else {
+							mode = INPUT_MODE_MEMORY;
+							input_buffer.clear();
+						}
+					} else if (ev.ch == 'a') {
+						show_disassembly = !show_disassembly;
+						dirty.mark(PANE_SOURCE);
+					} else if (ev.ch == 'W') {
+						mode = INPUT_MODE_WATCHPOINT;
+						input_buffer.clear();
+					} else if (ev.key == TB_KEY_TAB) {
+						sidebar_tab = (SidebarTab)((sidebar_tab + 1) % TAB_COUNT);
+						dirty.mark(PANE_WATCH);
+					} else if (ev.ch == 'R') {
+						watch_snapshot.invalidate();
+						dirty.mark(PANE_WATCH);
+						log_msg(log_buffer, "Refreshed watch expressions");
 					} else if (ev.ch == 'h') {
 						mode = INPUT_MODE_HELP;
+						dirty.mark_all();
+					} else if (ev.ch == 'i') {
+						step_repeat.cancel();
+						if (process.IsValid() && (process.GetState() == eStateRunning || process.GetState() == eStateStepping)) {
+							SBError error = process.Stop();
+							if (error.Fail()) {
+								log_msg(log_buffer, "Interrupt failed: " + std::string(error.GetCString() ? error.GetCString() : ""));
+							} else {
+								log_msg(log_buffer, "Interrupted");
+							}
+						}
 					} else {
-						if (process.IsValid() && process.GetState() == eStateStopped) {
+						if (process.IsValid() && is_stopped_state(process.GetState())) {
 							switch (ev.ch) {
-								case 'n': if (thread.IsValid()) thread.StepOver(); break;
-								case 's': if (thread.IsValid()) thread.StepInto(); break;
-								case 'o': if (thread.IsValid()) thread.StepOut(); break;
+								case 'n':
+								case 's':
+								case 'o':
+								case 'N':
+								case 'S':
+									if (thread.IsValid()) step_repeat.start(thread, (char)ev.ch, std::max(1, prefix));
+									break;
 								case 'c': process.Continue(); break;
+								case 'u':
+									if (cursor_line == 0) {
+										log_msg(log_buffer, "Click a source line first");
+									} else if (frame.IsValid() && frame.GetLineEntry().IsValid()) {
+										run_to.start(process, thread, frame, get_full_path(frame.GetLineEntry().GetFileSpec()), cursor_line, log_buffer);
+									}
+									break;
 							}
 						}
 
-						if (ev.key == TB_KEY_ARROW_LEFT && (ev.mod & TB_MOD_CTRL)) {
+						if (ev.key == TB_KEY_F2) {
+							show_stats = !show_stats;
+							dirty.mark_all();
+						} else if (ev.key == TB_KEY_ARROW_LEFT && (ev.mod & TB_MOD_CTRL)) {
 							layout_config.sidebar_width = std::min(width - 20, layout_config.sidebar_width + 2);
+							dirty.relayout();
 						} else if (ev.key == TB_KEY_ARROW_RIGHT && (ev.mod & TB_MOD_CTRL)) {
 							layout_config.sidebar_width = std::max(20, layout_config.sidebar_width - 2);
+							dirty.relayout();
 						} else if (ev.key == TB_KEY_ARROW_UP && (ev.mod & TB_MOD_CTRL)) {
 							layout_config.log_height = std::min(height - 10, layout_config.log_height + 1);
+							dirty.relayout();
 						} else if (ev.key == TB_KEY_ARROW_DOWN && (ev.mod & TB_MOD_CTRL)) {
 							layout_config.log_height = std::max(5, layout_config.log_height - 1);
+							dirty.relayout();
 						}
 					}
-				} else if (mode == INPUT_MODE_BREAKPOINT || mode == INPUT_MODE_VARIABLE || mode == INPUT_MODE_WATCH) {
+				} else if (mode == INPUT_MODE_BREAKPOINT || mode == INPUT_MODE_VARIABLE || mode == INPUT_MODE_WATCH || mode == INPUT_MODE_WATCHPOINT || mode == INPUT_MODE_MEMORY) {
 					if (ev.key == TB_KEY_ESC) {
 						mode = INPUT_MODE_NORMAL;
 						input_buffer.clear();
 					} else if (ev.key == TB_KEY_ENTER) {
 						if (!input_buffer.empty()) {
-							if (mode == INPUT_MODE_BREAKPOINT) {
+							if (mode == INPUT_MODE_BREAKPOINT && loader.loading()) {
+								startup_breakpoints.push_back(input_buffer);
+								log_msg(log_buffer, "Breakpoint queued until the target is loaded: " + input_buffer);
+							} else if (mode == INPUT_MODE_BREAKPOINT) {
 								SBBreakpoint bp = create_breakpoint(target, input_buffer);
 								if (bp.IsValid() && bp.GetNumLocations() > 0) {
 									log_msg(log_buffer, "Breakpoint added: " + input_buffer);
@@ -963,7 +3700,11 @@ int main(int argc, char** argv) {
 								if (!frame.IsValid()) {
 									log_msg(log_buffer, "Error: No stack frame available to evaluate '" + input_buffer + "'");
 								} else {
-									SBValue val = frame.EvaluateExpression(input_buffer.c_str());
+									WatchExpression expr(input_buffer);
+									bool used_path = false;
+									auto start = std::chrono::steady_clock::now();
+									SBValue val = evaluate_expression(frame, expr, used_path);
+									log_msg(log_buffer, "Evaluated '" + input_buffer + "' " + (used_path ? "by path" : "by expression") + " in " + format_ms(elapsed_ms(start)));
 									if (val.IsValid() && !val.GetError().Fail()) {
 										format_variable_log(val, log_buffer, 0, input_buffer);
 									} else {
@@ -976,8 +3717,35 @@ int main(int argc, char** argv) {
 									}
 								}
 							} else if (mode == INPUT_MODE_WATCH) {
-								watch_expressions.push_back(input_buffer);
+								watch_expressions.emplace_back(input_buffer);
+								dirty.mark(PANE_WATCH);
 								log_msg(log_buffer, "Added to watch: " + input_buffer);
+							} else if (mode == INPUT_MODE_WATCHPOINT) {
+								SBError error;
+								SBWatchpoint wp = create_watchpoint(target, frame, input_buffer, error);
+								if (wp.IsValid() && error.Success()) {
+									log_msg(log_buffer, "Watchpoint " + std::to_string(wp.GetID()) + " added: " + input_buffer);
+								} else {
+									log_msg(log_buffer, "Failed to add watchpoint '" + input_buffer + "': " + std::string(error.GetCString() ? error.GetCString() : "unknown error"));
+								}
+								dirty.mark(PANE_WATCH);
+							} else if (mode == INPUT_MODE_MEMORY) {
+								addr_t addr = 0;
+								bool found = false;
+								if (isdigit((unsigned char)input_buffer[0])) {
+									addr = strtoull(input_buffer.c_str(), nullptr, 0);
+									found = true;
+								} else if (frame.IsValid()) {
+									bool used_path = false;
+									found = memory_address_of(evaluate_expression(frame, WatchExpression(input_buffer), used_path), addr);
+								}
+								if (found) {
+									memory_view.open(addr, input_buffer);
+									show_memory = true;
+									dirty.mark(PANE_SOURCE);
+								} else {
+									log_msg(log_buffer, "No memory address for '" + input_buffer + "'");
+								}
 							}
 						}
 						mode = INPUT_MODE_NORMAL;
@@ -989,14 +3757,17 @@ int main(int argc, char** argv) {
 					}
 				} else if (mode == INPUT_MODE_HELP) {
 					mode = INPUT_MODE_NORMAL;
+					dirty.mark_all();
 				}
 			} else if (ev.type == TB_EVENT_MOUSE) {
+				bool is_action = (ev.key == TB_KEY_MOUSE_WHEEL_UP || ev.key == TB_KEY_MOUSE_WHEEL_DOWN || ev.key == TB_KEY_MOUSE_LEFT || ev.key == TB_KEY_MOUSE_RIGHT);
 				int main_window_height = tb_height() - layout_config.log_height - layout_config.status_height;
 
 				// Log window scrolling
 				int log_start_y = main_window_height;
 				int log_end_y = tb_height() - layout_config.status_height;
 				if (ev.x < split_x && ev.y >= log_start_y && ev.y < log_end_y) {
+					if (is_action) dirty.mark(PANE_LOG);
 					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
 						int max_scroll = std::max(0, (int)log_buffer.size() - (layout_config.log_height - 2));
 						if (log_scroll_offset < max_scroll) {
@@ -1009,18 +3780,36 @@ int main(int argc, char** argv) {
 					}
 				}
 
-				// Source window scrolling
-				if (ev.x < split_x && ev.y < main_window_height) {
+				// Memory scrolling, rows before the start address are fine too
+				if (show_memory && ev.x < split_x && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_SOURCE);
+					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
+						memory_view.scroll--;
+					} else if (ev.key == TB_KEY_MOUSE_WHEEL_DOWN) {
+						memory_view.scroll++;
+					}
+				}
+
+				// Disassembly scrolling, the view loads more code at either edge
+				if (showing_disassembly && ev.x < split_x && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_SOURCE);
+					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
+						disasm_view.scroll--;
+					} else if (ev.key == TB_KEY_MOUSE_WHEEL_DOWN) {
+						disasm_view.scroll++;
+					}
+				}
+
+				// Source window scrolling, a click sets the cursor line
+				if (!show_memory && !showing_disassembly && ev.x < split_x && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_SOURCE);
 					SBLineEntry le = frame.GetLineEntry();
 					if (le.IsValid()) {
-						std::string fullpath;
-						if (le.GetFileSpec().GetDirectory()) {
-							fullpath = std::string(le.GetFileSpec().GetDirectory()) + "/" + le.GetFileSpec().GetFilename();
-						} else {
-							fullpath = le.GetFileSpec().GetFilename();
+						if (ev.key == TB_KEY_MOUSE_LEFT && ev.y > 0 && ev.y < main_window_height - 1) {
+							cursor_line = source_scroll_offset + ev.y;
 						}
-						const std::vector<std::string>& lines = source_cache.get_lines(fullpath);
-						int total_lines = (int)lines.size();
+						std::string fullpath = get_full_path(le.GetFileSpec());
+						int total_lines = (int)source_cache.get(fullpath).line_count();
 						int ch = main_window_height - 2;
 						int max_scroll = std::max(0, total_lines - ch);
 
@@ -1040,15 +3829,26 @@ int main(int argc, char** argv) {
 				int split_x = tb_width() - layout_config.sidebar_width;
 				int locals_window_height = main_window_height - layout_config.watch_height;
 				if (ev.x >= split_x && ev.y < locals_window_height) {
-					std::vector<VarLine> lines;
-					if (frame.IsValid()) {
-						SBValueList vars = frame.GetVariables(true, true, false, true);
-						for (uint32_t i = 0; i < vars.GetSize(); ++i) {
-							collect_variables_recursive(vars.GetValueAtIndex(i), 0, lines, layout_config.sidebar_width - 2);
+					if (is_action) dirty.mark(PANE_LOCALS);
+					VarTree& tree = locals_snapshot.get_tree(frame);
+
+					if (ev.key == TB_KEY_MOUSE_LEFT && ev.y > 0 && ev.y < locals_window_height - 1) {
+						VarNode* node = tree.row_at(locals_scroll_offset + ev.y - 1);
+						if (node) tree.toggle(*node);
+					}
+
+					// Right click opens the memory a pointer points to, or the variable's own bytes
+					if (ev.key == TB_KEY_MOUSE_RIGHT && ev.y > 0 && ev.y < locals_window_height - 1) {
+						VarNode* node = tree.row_at(locals_scroll_offset + ev.y - 1);
+						addr_t addr = 0;
+						if (node && node->resolved && !node->is_page && memory_address_of(node->value, addr)) {
+							memory_view.open(addr, node->path);
+							show_memory = true;
+							dirty.mark(PANE_SOURCE);
 						}
 					}
-					int max_scroll = std::max(0, (int)lines.size() - (locals_window_height - 2));
 
+					int max_scroll = std::max(0, tree.row_count() - (locals_window_height - 2));
 					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
 						if (locals_scroll_offset > 0) {
 							locals_scroll_offset--;
@@ -1058,23 +3858,20 @@ int main(int argc, char** argv) {
 							locals_scroll_offset++;
 						}
 					}
+					locals_scroll_offset = std::min(locals_scroll_offset, max_scroll);
 				}
 
 				// Watch window scrolling
-				if (ev.x >= split_x && ev.y >= locals_window_height && ev.y < main_window_height) {
-					std::vector<VarLine> lines;
-					for (const auto& expr : watch_expressions) {
-						SBValue val = frame.EvaluateExpression(expr.c_str());
-						if (val.IsValid() && !val.GetError().Fail()) {
-							collect_variables_recursive(val, 0, lines, layout_config.sidebar_width - 2, expr);
-						} else {
-							VarLine vl;
-							vl.text = expr + " = (error)";
-							lines.push_back(vl);
-						}
+				if (sidebar_tab == TAB_WATCH && ev.x >= split_x && ev.y >= locals_window_height && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_WATCH);
+					VarTree& tree = watch_snapshot.get_tree(frame, watch_expressions, log_buffer);
+
+					if (ev.key == TB_KEY_MOUSE_LEFT && ev.y > locals_window_height && ev.y < main_window_height - 1) {
+						VarNode* node = tree.row_at(watch_scroll_offset + ev.y - locals_window_height - 1);
+						if (node) tree.toggle(*node);
 					}
-					int max_scroll = std::max(0, (int)lines.size() - (layout_config.watch_height - 2));
 
+					int max_scroll = std::max(0, tree.row_count() - (layout_config.watch_height - 2));
 					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
 						if (watch_scroll_offset > 0) {
 							watch_scroll_offset--;
@@ -1084,10 +3881,91 @@ int main(int argc, char** argv) {
 							watch_scroll_offset++;
 						}
 					}
+					watch_scroll_offset = std::min(watch_scroll_offset, max_scroll);
+				}
+
+				// Registers window scrolling, a click expands a register set
+				if (sidebar_tab == TAB_REGISTERS && ev.x >= split_x && ev.y >= locals_window_height && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_WATCH);
+					VarTree& tree = registers_snapshot.get_tree(frame);
+
+					if (ev.key == TB_KEY_MOUSE_LEFT && ev.y > locals_window_height && ev.y < main_window_height - 1) {
+						VarNode* node = tree.row_at(registers_scroll_offset + ev.y - locals_window_height - 1);
+						if (node) tree.toggle(*node);
+					}
+
+					int max_scroll = std::max(0, tree.row_count() - (layout_config.watch_height - 2));
+					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
+						if (registers_scroll_offset > 0) {
+							registers_scroll_offset--;
+						}
+					} else if (ev.key == TB_KEY_MOUSE_WHEEL_DOWN) {
+						if (registers_scroll_offset < max_scroll) {
+							registers_scroll_offset++;
+						}
+					}
+					registers_scroll_offset = std::min(registers_scroll_offset, max_scroll);
+				}
+
+				// Threads window scrolling, a click selects the thread
+				if (sidebar_tab == TAB_THREADS && frame.IsValid() && ev.x >= split_x && ev.y >= locals_window_height && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_WATCH);
+					threads_snapshot.sync(process);
+					int total = (int)threads_snapshot.rows.size();
+
+					if (ev.key == TB_KEY_MOUSE_LEFT && ev.y > locals_window_height && ev.y < main_window_height - 1) {
+						int idx = threads_scroll_offset + ev.y - locals_window_height - 1;
+						if (idx < total) {
+							process.SetSelectedThreadByID(threads_snapshot.rows[idx].tid);
+							dirty.mark(PANE_SOURCE);
+							dirty.mark(PANE_LOCALS);
+							dirty.mark(PANE_STATUS);
+						}
+					}
+
+					int max_scroll = std::max(0, total - (layout_config.watch_height - 2));
+					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
+						if (threads_scroll_offset > 0) {
+							threads_scroll_offset--;
+						}
+					} else if (ev.key == TB_KEY_MOUSE_WHEEL_DOWN) {
+						if (threads_scroll_offset < max_scroll) {
+							threads_scroll_offset++;
+						}
+					}
+					threads_scroll_offset = std::min(threads_scroll_offset, max_scroll);
+				}
+
+				// Stack window scrolling, a click selects the frame
+				if (sidebar_tab == TAB_STACK && frame.IsValid() && ev.x >= split_x && ev.y >= locals_window_height && ev.y < main_window_height) {
+					if (is_action) dirty.mark(PANE_WATCH);
+					stack_snapshot.sync(thread);
+
+					if (ev.key == TB_KEY_MOUSE_LEFT && ev.y > locals_window_height && ev.y < main_window_height - 1) {
+						uint32_t idx = stack_scroll_offset + ev.y - locals_window_height - 1;
+						if (stack_snapshot.has_frame(thread, idx)) {
+							thread.SetSelectedFrame(idx);
+							dirty.mark(PANE_SOURCE);
+							dirty.mark(PANE_LOCALS);
+							dirty.mark(PANE_STATUS);
+						}
+					}
+
+					if (ev.key == TB_KEY_MOUSE_WHEEL_UP) {
+						if (stack_scroll_offset > 0) {
+							stack_scroll_offset--;
+						}
+					} else if (ev.key == TB_KEY_MOUSE_WHEEL_DOWN) {
+						if (stack_snapshot.has_frame(thread, stack_scroll_offset + layout_config.watch_height - 2)) {
+							stack_scroll_offset++;
+						}
+					}
 				}
 			}
 		}
 	}
 
+	if (!core_mode) release_process(process, attach_pid > 0);
+	stats.dump(std::cerr);
 	return 0;
 }